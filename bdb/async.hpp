@@ -0,0 +1,123 @@
+#ifndef _BDB_ASYNC_HPP
+#define _BDB_ASYNC_HPP
+
+#include <string>
+#include "export.hpp"
+#include "common.hpp"
+#include "boost/function.hpp"
+#include "boost/thread/future.hpp"
+
+namespace BDB {
+
+	struct BehaviorDB;
+	struct AsyncImpl;
+
+	/** @brief Asynchronous front end of a BehaviorDB
+	 *  @details Requests are queued to an internal executor and the
+	 *  calling thread returns immediately. Completion is reported
+	 *  by the returned future and, optionally, by a handler invoked
+	 *  on the executor thread before the future becomes ready.
+	 *
+	 *  Requests on the same address (and on the same stream) are
+	 *  served in submission order, since they always go to the same
+	 *  worker of the executor.
+	 *
+	 *  @remark A BehaviorDB served by more than one worker must be
+	 *  created with Config::concurrent.
+	 */
+	struct BDB_EXPORT AsyncBehaviorDB
+	{
+		typedef boost::function<void(AddrType)> addr_handler;
+		typedef boost::function<void(size_t)> size_handler;
+		typedef boost::function<void(std::string const&)> data_handler;
+		typedef boost::function<void(stream_state const*)> state_handler;
+
+		/** @brief Constructor
+		 *  @param bdb BehaviorDB served, it must outlive this object.
+		 *  @param workers Number of worker threads.
+		 */
+		AsyncBehaviorDB(BehaviorDB &bdb, unsigned int workers = 1);
+
+		/** @brief Destructor
+		 *  @details Wait for all submitted requests to complete.
+		 */
+		~AsyncBehaviorDB();
+
+		/// @see BehaviorDB::put
+		boost::unique_future<AddrType>
+		async_put(std::string const& data, addr_handler h = addr_handler());
+
+		/// @see BehaviorDB::put
+		boost::unique_future<AddrType>
+		async_put(std::string const& data, AddrType addr, size_t off=npos,
+			addr_handler h = addr_handler());
+
+		/// @see BehaviorDB::update
+		boost::unique_future<AddrType>
+		async_update(std::string const& data, AddrType addr,
+			addr_handler h = addr_handler());
+
+		/** @brief Read at most max bytes from addr + off
+		 *  @see BehaviorDB::get
+		 */
+		boost::unique_future<std::string>
+		async_get(AddrType addr, size_t max, size_t off=0,
+			data_handler h = data_handler());
+
+		/// @see BehaviorDB::del
+		boost::unique_future<size_t>
+		async_del(AddrType addr, size_handler h = size_handler());
+
+		/// @see BehaviorDB::ostream
+		boost::unique_future<stream_state const*>
+		async_ostream(size_t stream_size, state_handler h = state_handler());
+
+		/// @see BehaviorDB::ostream
+		boost::unique_future<stream_state const*>
+		async_ostream(size_t stream_size, AddrType addr, size_t off=npos,
+			state_handler h = state_handler());
+
+		/// @see BehaviorDB::istream
+		boost::unique_future<stream_state const*>
+		async_istream(size_t stream_size, AddrType addr, size_t off=0,
+			state_handler h = state_handler());
+
+		/** @brief Write data to a stream
+		 *  @details data is copied, the caller needs not keep it.
+		 *  @see BehaviorDB::stream_write
+		 */
+		boost::unique_future<stream_state const*>
+		async_stream_write(stream_state const* state, std::string const& data,
+			state_handler h = state_handler());
+
+		/** @brief Read at most size bytes from a stream
+		 *  @return Data read, empty if the read failed.
+		 *  @see BehaviorDB::stream_read
+		 */
+		boost::unique_future<std::string>
+		async_stream_read(stream_state const* state, size_t size,
+			data_handler h = data_handler());
+
+		/// @see BehaviorDB::stream_finish
+		boost::unique_future<AddrType>
+		async_stream_finish(stream_state const* state,
+			addr_handler h = addr_handler());
+
+		/// @see BehaviorDB::stream_abort
+		boost::unique_future<void>
+		async_stream_abort(stream_state const* state);
+
+		/// Number of worker threads
+		unsigned int
+		workers() const;
+
+	private:
+		AsyncBehaviorDB(AsyncBehaviorDB const& cp);
+		AsyncBehaviorDB &operator=(AsyncBehaviorDB const& cp);
+
+		AsyncImpl *impl_;
+	};
+
+} // end of namespace BDB
+
+#endif // end of header
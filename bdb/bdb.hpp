@@ -57,6 +57,61 @@ namespace BDB {
 		AddrType
 		put(std::string const& data, AddrType addr, size_t off=npos);
 		
+        /** @brief Put a batch of data
+         *  @param segs Data to be put.
+         *  @param cnt Number of segments.
+         *  @param addrs Output addresses, -1 for failed ones.
+         *  @return Number of data put successfully.
+         *  @details Data are grouped by destination pool. Each pool
+         *  writes its chunks with vectored I/O and commits them once,
+         *  as does the global ID table.
+         */
+		size_t
+		put_batch(Segment const* segs, size_t cnt, AddrType *addrs);
+
+        /** @brief Put data gathered from segments
+         *  @param segs Pieces of the data in order.
+         *  @param cnt Number of segments.
+         *  @return Address of the data.
+         *  @details Segments are written with one vectored write, 
+         *  so callers need not copy them together.
+         */
+		AddrType
+		putv(Segment const* segs, size_t cnt);
+
+        /** @brief Append data gathered from segments to an address
+         *  @return addr or -1 for failure.
+         *  @see putv
+         */
+		AddrType
+		appendv(Segment const* segs, size_t cnt, AddrType addr);
+
+        /** @brief Put data read from a file descriptor
+         *  @param fd File, pipe or socket read from its current 
+         *  position. It should be blocking.
+         *  @param size Size to read.
+         *  @return Address of the data or -1 if it fails or fd ends
+         *  before size bytes.
+         *  @details Data are moved from fd to the pool file by 
+         *  copy_file_range or splice without passing user memory 
+         *  where it is supported.
+         *  @see stream_write_from_fd
+         */
+		AddrType
+		put_from_fd(int fd, size_t size);
+
+        /** @brief Append a batch of data to existing addresses
+         *  @param wvs Appends. Each one appends its buffer to 
+         *  *address; *address is set to -1 if it fails.
+         *  @param cnt Number of appends.
+         *  @return Number of appends done successfully.
+         *  @details Appends to the same address are merged in their
+         *  order in wvs, so each address is written, and migrated, at 
+         *  most once. All addresses are committed together.
+         */
+		size_t
+		append(WriteVector const* wvs, size_t cnt);
+		
         /** @brief Replace specific address with new data
          *  @param data New data.
          *  @param size Size of new data.
@@ -83,10 +138,75 @@ namespace BDB {
 		get(char *output, size_t size, AddrType addr, size_t off=0);
 		
         /** @brief std::string version get method
+         *  @remark output is resized once to the data read; nothing 
+         *  is allocated if its capacity is enough.
          */
 		size_t
 		get(std::string *output, size_t max, AddrType addr, size_t off=0);
 
+        /** @brief Map data of an address without copying it
+         *  @param addr Address.
+         *  @param off Offset.
+         *  @param size Maximum size of the view. Default is till 
+         *  the end of the data.
+         *  @return View of the data; its data is 0 for failure.
+         *  @details The data are mapped from the pool file read-only
+         *  and served by the page cache. The chunk is pinned, so 
+         *  deleting the address or moving its data to another chunk
+         *  leaves the view intact till release() is called. Appends
+         *  do not extend a view, while in-place writes covered by it,
+         *  e.g. update() of data that fit the chunk, are visible as 
+         *  with istream.
+         */
+		View
+		view(AddrType addr, size_t off=0, size_t size=npos);
+
+        /** @brief Release a view and unpin its chunk
+         */
+		void
+		release(View const& v);
+
+        /** @brief Send data of an address to a file descriptor
+         *  @param addr Address.
+         *  @param fd Socket, pipe or file to write to.
+         *  @param off Offset.
+         *  @param size Maximum size to send. Default is till the end
+         *  of the data.
+         *  @return Size sent, -1 for failure. Less than requested if
+         *  fd is non-blocking and would block.
+         *  @details Data go from the pool file to fd by sendfile 
+         *  without passing user memory where it is supported. The 
+         *  chunk is pinned during the call as by view().
+         */
+		size_t
+		send_to_fd(AddrType addr, int fd, size_t off=0, size_t size=npos);
+
+        /** @brief Scatter data of an address to segments
+         *  @param segs Output buffers filled in order.
+         *  @param cnt Number of segments.
+         *  @param addr Address.
+         *  @param off Offset.
+         *  @return Size of data read successfully.
+         */
+		size_t
+		getv(MutableSegment const* segs, size_t cnt, AddrType addr, 
+			size_t off=0);
+
+        /** @brief Read a batch of addresses
+         *  @param addrs Addresses.
+         *  @param cnt Number of addresses.
+         *  @param buffers Output buffer of each address.
+         *  @param sizes Size of each buffer as input. Size of data read
+         *  as output, 0 for addresses that do not exist.
+         *  @return Number of addresses read successfully.
+         *  @details Addresses are grouped by pool and read in order of
+         *  their positions in the pool file. Adjacent chunks are read
+         *  together, so each pool is read by a single sequential pass.
+         */
+		size_t
+		get_batch(AddrType const* addrs, size_t cnt, 
+			char* const* buffers, size_t *sizes);
+
         /** @brief Delete specified address.
          *  @return 0 for success. -1 for failure.
          */
@@ -98,17 +218,41 @@ namespace BDB {
          */
 		size_t
 		del(AddrType addr, size_t off, size_t size);
+
+        /** @brief Delete a batch of addresses
+         *  @return Number of addresses deleted.
+         *  @details IDs are released in memory first and committed
+         *  together; consecutive ones are recorded as ranges.
+         */
+		size_t
+		del_batch(AddrType const* addrs, size_t cnt);
+
+        /** @brief Delete all addresses in [first, last)
+         *  @return Number of addresses deleted.
+         *  @details The range is clipped to the highest address in
+         *  use and scanned before any lock is taken; runs of deleted
+         *  addresses are recorded as ranges. Addresses held by 
+         *  streams are left alone.
+         */
+		size_t
+		del_range(AddrType first, AddrType last);
 	
         /** @brief Create output stream handle, stream_state, for 
          *  asynchronous write.
-         *  @param stream_size Future size this handle will be written.
+         *  @param stream_size Future size this handle will be written,
+         *  or BDB::npos if it is unknown.
          *  @return stream_state or NULL if any error occured.
+         *  @details A stream of unknown size starts in the smallest 
+         *  pool and moves to a chunk of a larger pool whenever it 
+         *  runs out of room, so at most as much as the data written 
+         *  is copied. stream_finish trims the unwritten room.
          */
 		stream_state const*
 		ostream(size_t stream_size);
         
         /** @brief Create output stream handle, stream_state, for 
-         *  asynchronous write from an existed address. Offset of a
+         *  asynchronous write from an existed address. stream_size
+         *  must be known. Offset of a
          *  chunk refered by the address can be assigned optionally.
          *  Default offset is the end of a chunk refered by the address.
          *  @return stream_state or NULL if any error occured.
@@ -132,8 +276,20 @@ namespace BDB {
 		stream_state const*
 		stream_write(stream_state const* state, char const* data, size_t size);
 		
+        /** @brief Write data read from a file descriptor to a 
+         *  stream_state created by ostream method.
+         *  @details Pending buffered data are written first. The 
+         *  stream fails if fd ends before size bytes.
+         *  @return stream_state or NULL if any error occured.
+         *  @see put_from_fd
+         */
+		stream_state const*
+		stream_write_from_fd(stream_state const* state, int fd, size_t size);
+		
         /** @brief Read data from a stream_state created by istream method.
          *  @return stream_state or NULL if any error occured.
+         *  @remark Data updated or appended in place while the stream 
+         *  is open are seen by later reads.
          */
 		stream_state const*
 		stream_read(stream_state const* state, char* output, size_t size);
@@ -149,10 +305,26 @@ namespace BDB {
          *  @remark The encryption is required for
          *  preventing directly delete/free to the 
          *  stream_state.
+         *  @details Paused output streams are journaled, so they can
+         *  be resumed after the BehaviorDB is reopened. Destination
+         *  chunks of streams neither paused nor finished are freed 
+         *  when it is reopened. Paused input streams are not kept.
          */
 		size_t
 		stream_pause(stream_state const* state);
 
+        /** @brief Resize write-combining buffer of an output stream
+         *  @param size Writes smaller than size are buffered and 
+         *  written in large pieces. 0 disables buffering.
+         *  @return state
+         *  @details Buffered data are written when the buffer fills,
+         *  before stream_finish and before stream_pause. Pending data 
+         *  are written before resizing.
+         *  @see Config::stream_buf_size
+         */
+		stream_state const*
+		stream_buffer(stream_state const* state, size_t size);
+
         /** @brief Resume an asynchronous read/write.
          *  @return stream_state.
          */
@@ -190,6 +362,21 @@ namespace BDB {
          */
 		void stat(Stat * ms) const;
 
+        /** @brief Render stat() in Prometheus text exposition format.
+         *  @param out Replaced by the text.
+         *  @see Config::metrics_interval
+         */
+		void metrics(std::string *out) const;
+		
+        /** @brief Set how much memory of idle migration buffers is kept.
+         *  @param bytes Cap in bytes, at least one buffer (2 MB) is kept.
+         *  @details Migration buffers are shared by all BehaviorDBs in a
+         *  process. Buffers returned beyond the cap are freed. Threads 
+         *  migrating at once still get a buffer each, so memory in use 
+         *  may exceed the cap. Default is one buffer per hardware thread.
+         */
+		static void buffer_retention(size_t bytes);
+
 	private:
 		BehaviorDB(BehaviorDB const& cp);
 		BehaviorDB &operator=(BehaviorDB const& cp);
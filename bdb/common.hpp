@@ -28,6 +28,8 @@
 
 // TODO make sure this is OK in win
 #include <stddef.h>
+#include <cstdio>
+#include <vector>
 
 namespace BDB {
 	
@@ -102,6 +104,41 @@ namespace BDB {
         /// Capacity testing callback
 		Capacity_test ct_func;
 
+		/// Allow a BehaviorDB to be shared among threads.
+		/** Each pool is guarded by its own lock so that operations 
+		 *  on different pools or addresses proceed in parallel. 
+		 *  Default is false, i.e. no locking at all.
+		 */
+		bool concurrent;
+
+		/// Default size of write-combining buffers of output streams.
+		/** Writes smaller than it are collected and written in large
+		 *  pieces. 0 disables buffering. Default is 256KB.
+		 *  @see BehaviorDB::stream_buffer
+		 */
+		size_t stream_buf_size;
+
+		/// Record one of every access_log_sample operations in the access log.
+		/** The access log is written in binary by a background thread,
+		 *  see tools/logcvt for conversion to text. 0 disables it.
+		 *  Default is 1, i.e. every operation.
+		 */
+		unsigned int access_log_sample;
+
+		/// Records buffered for the access log writer.
+		/** Operations that find the buffer full are not recorded but
+		 *  counted. Default is 4096.
+		 */
+		size_t access_log_ring;
+
+		/// Seconds between writes of metrics.prom in log_dir.
+		/** Metrics are in Prometheus text format, see 
+		 *  BehaviorDB::metrics. They are written by a background 
+		 *  thread, so concurrent must be true. 0 disables the file.
+		 *  Default is 0.
+		 */
+		unsigned int metrics_interval;
+
 		/** @brief Config default constructor 
 		 *  @details Construct BDB::Config with default configurations  
 		 */
@@ -115,7 +152,12 @@ namespace BDB {
 			char const *header_dir = "",
 			char const *log_dir = "",
 			Chunk_size_est cse_func = &default_chunk_size_est,
-			Capacity_test ct_func = &default_capacity_test 
+			Capacity_test ct_func = &default_capacity_test,
+			bool concurrent = false,
+			size_t stream_buf_size = 256*1024,
+			unsigned int access_log_sample = 1,
+			size_t access_log_ring = 4096,
+			unsigned int metrics_interval = 0
 			);
 
 		/** @brief Validate configuration
@@ -125,6 +167,152 @@ namespace BDB {
 		validate() const;
 	};
 	
+	/// A piece of caller's data for batch and vectored calls
+	struct Segment
+	{
+		char const *data;
+		size_t size;
+	};
+	
+	/// A piece of caller's buffer for scatter reads
+	struct MutableSegment
+	{
+		char *data;
+		size_t size;
+	};
+	
+	/// An append of buffer to *address for BehaviorDB::append
+	struct WriteVector
+	{
+		char const *buffer;
+		size_t size;
+		AddrType *address;
+	};
+	
+	/** @brief Read-only view of data of an address
+	 *  @details data is 0 if the view failed.
+	 *  @see BehaviorDB::view
+	 */
+	struct View
+	{
+		char const *data;
+		size_t size;
+		
+		/// Chunk pinned by the view, for BehaviorDB::release
+		AddrType chunk;
+	};
+	
+	/// Operations timed in PoolStat
+	enum StatOp {
+		STAT_PUT = 0,	///< put
+		STAT_INSERT,	///< put at an address, appendv
+		STAT_UPDATE,	///< update
+		STAT_GET,	///< get, getv, view, send_to_fd
+		STAT_DEL,	///< del, partial del
+		STAT_STREAM,	///< ostream, istream, stream_finish
+		STAT_OP_CNT
+	};
+
+	/** @brief Latency histogram in log-scaled buckets
+	 *  @details Latencies below 4ns have a bucket each; above that
+	 *  every power of 2 is split into 4 buckets, so a value is at most
+	 *  25% below the upper bound of its bucket. The last bucket also
+	 *  holds everything above 8.5s.
+	 */
+	struct LatencyHist
+	{
+		enum { BUCKETS = 128 };
+
+		/// samples in each bucket
+		unsigned long long count[BUCKETS];
+
+		/// sum of all samples in ns
+		unsigned long long total_ns;
+
+		/// largest sample in ns
+		unsigned long long max_ns;
+
+		LatencyHist();
+
+		/// number of samples
+		unsigned long long
+		samples() const;
+
+		/// upper bound of the p quantile in ns, p in [0, 1]
+		unsigned long long
+		percentile(double p) const;
+
+		void
+		merge(LatencyHist const& h);
+
+		/// bucket holding ns
+		static unsigned int
+		bucket(unsigned long long ns);
+
+		/// largest value of bucket b in ns
+		static unsigned long long
+		upper_bound(unsigned int b);
+	};
+
+	/// Statistic of a pool directory
+	struct PoolStat
+	{
+		/// latency of operations on chunks of the pool, by StatOp
+		LatencyHist latency[STAT_OP_CNT];
+
+		/// chunks moved out of the pool since they grew
+		unsigned long long migrations;
+
+		/// bytes copied by migrations
+		unsigned long long migrated_bytes;
+
+		/// chunk size of the pool
+		unsigned long long chunk_size;
+
+		/// chunks in use
+		unsigned long long chunks;
+
+		/// chunk slots up to the last one in use, free or not
+		unsigned long long slots;
+
+		/// bytes of data in chunks in use
+		unsigned long long data_bytes;
+
+		/// bytes of data asked to be written since the pool is opened
+		unsigned long long bytes_requested;
+
+		/** @brief bytes written to the pool file since it is opened
+		 *  @details Including data copied by migrations and moved by
+		 *  inserts and partial deletes.
+		 */
+		unsigned long long bytes_written;
+
+		PoolStat():migrations(0), migrated_bytes(0), chunk_size(0),
+			chunks(0), slots(0), data_bytes(0), 
+			bytes_requested(0), bytes_written(0)
+		{}
+
+		/// data over the space of all slots
+		double
+		occupancy() const
+		{ return slots ? (double)data_bytes / (slots * chunk_size) : 0; }
+
+		/// unused fraction of chunks in use
+		double
+		internal_fragmentation() const
+		{ return chunks ? 1 - (double)data_bytes / (chunks * chunk_size) : 0; }
+
+		/// fraction of slots that are free holes
+		double
+		external_fragmentation() const
+		{ return slots ? (double)(slots - chunks) / slots : 0; }
+
+		/// bytes written per byte requested
+		double
+		write_amplification() const
+		{ return bytes_requested ? (double)bytes_written / bytes_requested : 0; }
+	};
+	
 	/// Memory/Disk Statistic
 	struct Stat
 	{
@@ -137,8 +325,33 @@ namespace BDB {
         /// disk usage
 		unsigned long long disk_size;
 
-		Stat():gid_mem_size(0), pool_mem_size(0), disk_size(0)
-		{}
+		/// migration buffers allocated, shared by all BehaviorDBs
+		unsigned long long buf_mem_size;
+
+		/// migration buffers borrowed from the ones retained
+		unsigned long long buf_hits;
+
+		/// migration buffers allocated since none was retained
+		unsigned long long buf_misses;
+
+		enum { ERROR_SLOTS = 8 };
+
+		/// errors by ERRORNUMBER, see concepts/error.markdown
+		unsigned long long errors[ERROR_SLOTS];
+
+		/** @brief Operation statistic by pool directory
+		 *  @details Batch operations are not timed. Stat of sharded
+		 *  BehaviorDBs are summed by directory.
+		 */
+		std::vector<PoolStat> pools;
+
+		Stat():gid_mem_size(0), pool_mem_size(0), disk_size(0), 
+			buf_mem_size(0), buf_hits(0), buf_misses(0)
+		{ for(int i=0; i<ERROR_SLOTS; ++i) errors[i] = 0; }
+
+		/// Print in text, e.g. for logs
+		void
+		dump(FILE *fp) const;
 	};
 	
 	/// Not a Position
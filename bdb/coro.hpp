@@ -0,0 +1,163 @@
+#ifndef _BDB_CORO_HPP
+#define _BDB_CORO_HPP
+
+#include "async.hpp"
+
+// Coroutine interface needs a C++20 compiler; nothing is declared otherwise.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <exception>
+#include <string>
+#include <utility>
+
+namespace BDB {
+namespace coro {
+
+	/** @brief Fire-and-forget coroutine type
+	 *  @details The body runs eagerly till its first co_await. It is
+	 *  then resumed by the worker of AsyncBehaviorDB that completes the
+	 *  awaited request, so a long body holds that worker meanwhile.
+	 */
+	struct detached
+	{
+		struct promise_type
+		{
+			detached get_return_object() noexcept { return detached(); }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() noexcept {}
+			void unhandled_exception() noexcept { std::terminate(); }
+		};
+	};
+
+	/** @brief Awaitable wrapping one AsyncBehaviorDB request
+	 *  @details Start is called with a handler that stores the result
+	 *  and resumes the awaiting coroutine.
+	 */
+	template<typename R, typename Start>
+	struct awaiter
+	{
+		awaiter(Start start)
+		: start_(std::move(start)), rt_()
+		{}
+
+		bool await_ready() const noexcept { return false; }
+
+		void
+		await_suspend(std::coroutine_handle<> h)
+		{
+			// the coroutine may be resumed before start_ returns,
+			// this must not be touched afterwards
+			awaiter *self = this;
+			start_([self, h](R const& rt){ self->rt_ = rt; h.resume(); });
+		}
+
+		R await_resume() { return std::move(rt_); }
+
+	private:
+		Start start_;
+		R rt_;
+	};
+
+	template<typename R, typename Start>
+	awaiter<R, Start>
+	make_awaiter(Start start)
+	{ return awaiter<R, Start>(std::move(start)); }
+
+	/// co_await put(db, data) -> AddrType
+	inline auto
+	put(AsyncBehaviorDB &db, std::string data)
+	{
+		return make_awaiter<AddrType>(
+			[&db, data = std::move(data)](AsyncBehaviorDB::addr_handler h)
+			{ db.async_put(data, h); });
+	}
+
+	/// co_await put(db, data, addr, off) -> AddrType
+	inline auto
+	put(AsyncBehaviorDB &db, std::string data, AddrType addr, size_t off=npos)
+	{
+		return make_awaiter<AddrType>(
+			[&db, data = std::move(data), addr, off](AsyncBehaviorDB::addr_handler h)
+			{ db.async_put(data, addr, off, h); });
+	}
+
+	/// co_await get(db, addr, max, off) -> std::string
+	inline auto
+	get(AsyncBehaviorDB &db, AddrType addr, size_t max, size_t off=0)
+	{
+		return make_awaiter<std::string>(
+			[&db, addr, max, off](AsyncBehaviorDB::data_handler h)
+			{ db.async_get(addr, max, off, h); });
+	}
+
+	/// co_await del(db, addr) -> size_t
+	inline auto
+	del(AsyncBehaviorDB &db, AddrType addr)
+	{
+		return make_awaiter<size_t>(
+			[&db, addr](AsyncBehaviorDB::size_handler h)
+			{ db.async_del(addr, h); });
+	}
+
+	/// co_await ostream(db, stream_size) -> stream_state const*
+	inline auto
+	ostream(AsyncBehaviorDB &db, size_t stream_size)
+	{
+		return make_awaiter<stream_state const*>(
+			[&db, stream_size](AsyncBehaviorDB::state_handler h)
+			{ db.async_ostream(stream_size, h); });
+	}
+
+	/// co_await ostream(db, stream_size, addr, off) -> stream_state const*
+	inline auto
+	ostream(AsyncBehaviorDB &db, size_t stream_size, AddrType addr, size_t off=npos)
+	{
+		return make_awaiter<stream_state const*>(
+			[&db, stream_size, addr, off](AsyncBehaviorDB::state_handler h)
+			{ db.async_ostream(stream_size, addr, off, h); });
+	}
+
+	/// co_await istream(db, stream_size, addr, off) -> stream_state const*
+	inline auto
+	istream(AsyncBehaviorDB &db, size_t stream_size, AddrType addr, size_t off=0)
+	{
+		return make_awaiter<stream_state const*>(
+			[&db, stream_size, addr, off](AsyncBehaviorDB::state_handler h)
+			{ db.async_istream(stream_size, addr, off, h); });
+	}
+
+	/// co_await write_some(db, state, data) -> stream_state const*
+	inline auto
+	write_some(AsyncBehaviorDB &db, stream_state const* state, std::string data)
+	{
+		return make_awaiter<stream_state const*>(
+			[&db, state, data = std::move(data)](AsyncBehaviorDB::state_handler h)
+			{ db.async_stream_write(state, data, h); });
+	}
+
+	/// co_await read_some(db, state, size) -> std::string, empty at the end
+	inline auto
+	read_some(AsyncBehaviorDB &db, stream_state const* state, size_t size)
+	{
+		return make_awaiter<std::string>(
+			[&db, state, size](AsyncBehaviorDB::data_handler h)
+			{ db.async_stream_read(state, size, h); });
+	}
+
+	/// co_await finish(db, state) -> AddrType
+	inline auto
+	finish(AsyncBehaviorDB &db, stream_state const* state)
+	{
+		return make_awaiter<AddrType>(
+			[&db, state](AsyncBehaviorDB::addr_handler h)
+			{ db.async_stream_finish(state, h); });
+	}
+
+} // end of namespace coro
+} // end of namespace BDB
+
+#endif // __cpp_impl_coroutine
+
+#endif // end of header
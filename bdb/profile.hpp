@@ -0,0 +1,28 @@
+#ifndef _BDB_PROFILE_HPP
+#define _BDB_PROFILE_HPP
+
+#include "export.hpp"
+#include <cstdio>
+
+namespace BDB {
+
+	/** @brief Print time spent in each stage of operations
+	 *  @details Stages are address translation, chunk header I/O,
+	 *  data I/O, migration, transaction commit and logging; the rest
+	 *  of operations is reported as "op". Time of a stage excludes
+	 *  stages nested in it and is summed over all threads. It is in
+	 *  TSC cycles on x86 and in ns elsewhere.
+	 *  @return false if the library is built without BDB_PROFILE
+	 *  @remark The breakdown is also printed to stderr when a
+	 *  BehaviorDB is destroyed in a BDB_PROFILE build.
+	 */
+	BDB_EXPORT bool
+	profile_dump(FILE *fp);
+
+	/// Clear counters of all threads
+	BDB_EXPORT void
+	profile_reset();
+
+} // end of namespace BDB
+
+#endif // end of header
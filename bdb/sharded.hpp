@@ -0,0 +1,230 @@
+#ifndef _BDB_SHARDED_HPP
+#define _BDB_SHARDED_HPP
+
+#include <string>
+#include "export.hpp"
+#include "common.hpp"
+
+namespace BDB {
+
+	struct BehaviorDB;
+	struct ShardedImpl;
+
+	/** @brief Router over independent BehaviorDB instances
+	 *  @details [conf.beg, conf.end) is split evenly into shard_cnt
+	 *  consecutive ranges. Each range is served by its own BehaviorDB
+	 *  rooted at root_dirs[i] (which may be on different devices), so
+	 *  an address always routes to the shard owning it. New data are
+	 *  spread over shards round-robin.
+	 *  pool_dir, trans_dir and header_dir of conf are ignored, all
+	 *  files of a shard are placed in its root_dir.
+	 *  @remark Address iteration (begin/end) and view/release are 
+	 *  not routed; use them on shard(shard_of(addr)).
+	 */
+	struct BDB_EXPORT ShardedBehaviorDB
+	{
+		/** @brief Constructor
+		 *  @param conf Configuration shared by all shards.
+		 *  @param root_dirs Root directory of each shard.
+		 *  @param shard_cnt Number of shards.
+		 *  @throw std::invalid_argument
+		 *  @throw std::bad_alloc
+		 *  @throw std::runtime_error
+		 *  @throw std::length_error
+		 */
+		ShardedBehaviorDB(Config const &conf,
+			char const* const* root_dirs, unsigned int shard_cnt);
+
+		~ShardedBehaviorDB();
+
+		/// @see BehaviorDB::put
+		AddrType
+		put(char const *data, size_t size);
+
+		/// @see BehaviorDB::put
+		AddrType
+		put(char const *data, size_t size, AddrType addr, size_t off=npos);
+
+		/// @see BehaviorDB::put
+		AddrType
+		put(std::string const& data);
+
+		/// @see BehaviorDB::put
+		AddrType
+		put(std::string const& data, AddrType addr, size_t off=npos);
+
+		/// @see BehaviorDB::putv
+		AddrType
+		putv(Segment const* segs, size_t cnt);
+
+		/// @see BehaviorDB::appendv
+		AddrType
+		appendv(Segment const* segs, size_t cnt, AddrType addr);
+
+		/// @see BehaviorDB::put_from_fd
+		AddrType
+		put_from_fd(int fd, size_t size);
+
+		/** @brief Append a batch of data to existing addresses
+		 *  @details Shards involved are served in parallel.
+		 *  @see BehaviorDB::append
+		 */
+		size_t
+		append(WriteVector const* wvs, size_t cnt);
+
+		/// @see BehaviorDB::update
+		AddrType
+		update(char const* data, size_t size, AddrType addr);
+
+		/// @see BehaviorDB::update
+		AddrType
+		update(std::string const& data, AddrType addr);
+
+		/// @see BehaviorDB::get
+		size_t
+		get(char *output, size_t size, AddrType addr, size_t off=0);
+
+		/// @see BehaviorDB::get
+		size_t
+		get(std::string *output, size_t max, AddrType addr, size_t off=0);
+
+		/// @see BehaviorDB::getv
+		size_t
+		getv(MutableSegment const* segs, size_t cnt, AddrType addr, 
+			size_t off=0);
+
+		/// @see BehaviorDB::send_to_fd
+		size_t
+		send_to_fd(AddrType addr, int fd, size_t off=0, size_t size=npos);
+
+		/// @see BehaviorDB::del
+		size_t
+		del(AddrType addr);
+
+		/// @see BehaviorDB::del
+		size_t
+		del(AddrType addr, size_t off, size_t size);
+
+		/** @brief Put a batch of data
+		 *  @param data Data to be put.
+		 *  @param addrs Output addresses, -1 for failed ones.
+		 *  @param cnt Number of data.
+		 *  @return Number of data put successfully.
+		 *  @details Shards involved are served in parallel, by the 
+		 *  calling thread and a thread kept for each other shard.
+		 *  An exception thrown for any shard is rethrown to the caller
+		 *  once all shards are done.
+		 */
+		size_t
+		put_batch(std::string const* data, AddrType *addrs, size_t cnt);
+
+		/// @see BehaviorDB::put_batch
+		size_t
+		put_batch(Segment const* segs, size_t cnt, AddrType *addrs);
+
+		/** @brief Get a batch of addresses
+		 *  @param outputs Output strings.
+		 *  @param max Maximum size of each output.
+		 *  @param addrs Addresses.
+		 *  @param cnt Number of addresses.
+		 *  @return Number of addresses read successfully.
+		 *  @details Shards involved are served in parallel.
+		 */
+		size_t
+		get_batch(std::string *outputs, size_t max,
+			AddrType const* addrs, size_t cnt);
+
+		/** @brief Delete a batch of addresses
+		 *  @return Number of addresses deleted successfully.
+		 *  @details Shards involved are served in parallel.
+		 */
+		size_t
+		del_batch(AddrType const* addrs, size_t cnt);
+
+		/// @see BehaviorDB::del_range
+		size_t
+		del_range(AddrType first, AddrType last);
+
+		/// @see BehaviorDB::ostream
+		stream_state const*
+		ostream(size_t stream_size);
+
+		/// @see BehaviorDB::ostream
+		stream_state const*
+		ostream(size_t stream_size, AddrType addr, size_t off=npos);
+
+		/// @see BehaviorDB::istream
+		stream_state const*
+		istream(size_t stream_size, AddrType addr, size_t off=0);
+
+		/// @see BehaviorDB::stream_write
+		stream_state const*
+		stream_write(stream_state const* state, char const* data, size_t size);
+
+		/// @see BehaviorDB::stream_write_from_fd
+		stream_state const*
+		stream_write_from_fd(stream_state const* state, int fd, size_t size);
+
+		/// @see BehaviorDB::stream_read
+		stream_state const*
+		stream_read(stream_state const* state, char* output, size_t size);
+
+		/// @see BehaviorDB::stream_finish
+		AddrType
+		stream_finish(stream_state const* state);
+
+		/// @see BehaviorDB::stream_pause
+		size_t
+		stream_pause(stream_state const* state);
+
+		/// @see BehaviorDB::stream_buffer
+		stream_state const*
+		stream_buffer(stream_state const* state, size_t size);
+
+		/// @see BehaviorDB::stream_resume
+		stream_state const*
+		stream_resume(size_t encrypt_handle);
+
+		/// @see BehaviorDB::stream_expire
+		void
+		stream_expire(size_t encrypt_handle);
+
+		/// @see BehaviorDB::stream_abort
+		void
+		stream_abort(stream_state const* state);
+
+		/// Number of shards
+		unsigned int
+		shard_count() const;
+
+		/** @brief Shard owning an address
+		 *  @return Index of the shard or -1 if addr is out of range.
+		 */
+		unsigned int
+		shard_of(AddrType addr) const;
+
+		/** @brief Access a shard, e.g. for iterating its addresses
+		 */
+		BehaviorDB &
+		shard(unsigned int i);
+
+		/** @brief Statistic info summed over all shards
+		 *  @see Stat
+		 */
+		void stat(Stat * ms) const;
+
+		/** @brief Render stat() summed over all shards in Prometheus 
+		 *  text exposition format
+		 */
+		void metrics(std::string *out) const;
+
+	private:
+		ShardedBehaviorDB(ShardedBehaviorDB const& cp);
+		ShardedBehaviorDB &operator=(ShardedBehaviorDB const& cp);
+
+		ShardedImpl *impl_;
+	};
+
+} // end of namespace BDB
+
+#endif // end of header
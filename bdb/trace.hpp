@@ -0,0 +1,103 @@
+#ifndef _BDB_TRACE_HPP
+#define _BDB_TRACE_HPP
+
+#include "export.hpp"
+#include "common.hpp"
+#include "boost/thread/mutex.hpp"
+#include <cstdio>
+
+namespace BDB {
+
+	/** @brief Stages reported by trace points
+	 *  @remark Trace points are compiled in only when the library is
+	 *  built with BDB_TRACE defined, see the BDB_TRACE CMake option.
+	 */
+	enum TraceStage {
+		TRACE_OP = 0,       ///< An operation of BehaviorDB
+		TRACE_POOL_READ,    ///< A read method of a pool
+		TRACE_POOL_WRITE,   ///< A write, free or move method of a pool
+		TRACE_HEADER_READ,  ///< Chunk headers read
+		TRACE_HEADER_WRITE, ///< Chunk headers written and flushed
+		TRACE_SEEK,         ///< Seek of a pool file
+		TRACE_FILE_READ,    ///< Data read from a file or sent from it
+		TRACE_FILE_WRITE,   ///< Data written to a file or received
+		TRACE_COMMIT,       ///< Transaction record written
+		TRACE_ACCESS_LOG,   ///< Access log and latency recorded
+		TRACE_STAGE_CNT
+	};
+
+	/** @brief One end of a traced stage
+	 *  @details Stages of a thread nest: every begin is followed by
+	 *  its end before the enclosing stage ends.
+	 */
+	struct TraceEvent
+	{
+		unsigned int stage;  ///< TraceStage
+		bool begin;          ///< false for the end of the stage
+		unsigned int op;     ///< Operation being served by the thread
+		unsigned int thread; ///< Small ID of the thread, from 1
+		int pool;            ///< dirID or -1 for none or unknown
+		AddrType addr;       ///< Address, external for TRACE_OP
+		size_t bytes;        ///< Bytes requested, 0 if not applicable
+		unsigned long long time; ///< Monotonic time in ns
+	};
+
+	/// Name of a TraceStage
+	BDB_EXPORT char const*
+	trace_stage_name(unsigned int stage);
+
+	/// Name of TraceEvent::op, as used in access logs
+	BDB_EXPORT char const*
+	trace_op_name(unsigned int op);
+
+	/** @brief Receiver of trace events
+	 *  @remark event() is called by every thread running operations,
+	 *  concurrently when Config::concurrent is set.
+	 */
+	struct BDB_EXPORT TraceSink
+	{
+		virtual ~TraceSink() {}
+
+		virtual void
+		event(TraceEvent const &ev) = 0;
+	};
+
+	/** @brief Write events in the Chrome trace event format
+	 *  @details The file can be loaded by chrome://tracing or
+	 *  Perfetto. Each traced thread is shown as a timeline of
+	 *  nested stages.
+	 */
+	class BDB_EXPORT ChromeTraceSink : public TraceSink
+	{
+	public:
+		/** @throw std::runtime_error if fname can not be created
+		 */
+		explicit ChromeTraceSink(char const* fname);
+
+		/// Terminate the JSON document
+		~ChromeTraceSink();
+
+		void
+		event(TraceEvent const &ev);
+
+	private:
+		ChromeTraceSink(ChromeTraceSink const &cp);
+		ChromeTraceSink& operator=(ChromeTraceSink const &cp);
+
+		boost::mutex mutex_;
+		FILE *file_;
+		bool first_;
+		unsigned long long base_;
+	};
+
+	/** @brief Send events of all BehaviorDB to sink
+	 *  @param sink 0 stops tracing. It must not be destroyed until
+	 *  it has been replaced and operations started before are done.
+	 *  @return false if the library is built without trace points
+	 */
+	BDB_EXPORT bool
+	set_trace_sink(TraceSink *sink);
+
+} // end of namespace BDB
+
+#endif // end of header
@@ -0,0 +1,145 @@
+#include "access_log.hpp"
+#include "boost/bind.hpp"
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <time.h>
+
+namespace BDB {
+
+	namespace {
+
+		boost::uint64_t
+		clock_ns(clockid_t clk)
+		{
+			struct timespec ts;
+			clock_gettime(clk, &ts);
+			return (boost::uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+		}
+
+	} // end of anonymous namespace
+
+	access_log::access_log()
+	: ring_(0), mask_(0), sample_(1), head_(0), tail_(0), tick_(0),
+	  dropped_(0), dropped_logged_(0), stop_(false),
+	  mono_base_(0), real_base_(0), file_(0)
+	{}
+
+	access_log::~access_log()
+	{
+		if(0 == ring_) return;
+		stop_.store(true, boost::memory_order_release);
+		writer_.join();
+		fclose(file_);
+		delete [] ring_;
+	}
+
+	void
+	access_log::open(char const* fname, size_t capacity, unsigned int sample)
+	{
+		assert(0 == ring_ && "access_log is opened twice");
+
+		if(0 == (file_ = fopen(fname, "ab")))
+			throw std::runtime_error("create access log file failed\n");
+		if(0 == ftello(file_) &&
+			1 != fwrite(ACCESS_LOG_MAGIC, ACCESS_LOG_MAGIC_LEN, 1, file_))
+		{
+			fclose(file_);
+			file_ = 0;
+			throw std::runtime_error("write access log file failed\n");
+		}
+
+		size_t cap(2);
+		while(cap < capacity) cap <<= 1;
+		ring_ = new slot[cap];
+		for(size_t i=0; i<cap; ++i)
+			ring_[i].seq.store(i, boost::memory_order_relaxed);
+		mask_ = cap - 1;
+		sample_ = sample ? sample : 1;
+
+		mono_base_ = now();
+		real_base_ = clock_ns(CLOCK_REALTIME);
+		writer_ = boost::thread(boost::bind(&access_log::run, this));
+	}
+
+	boost::uint64_t
+	access_log::now()
+	{ return clock_ns(CLOCK_MONOTONIC); }
+
+	void
+	access_log::push(unsigned int op, boost::uint64_t t0, boost::uint64_t lat,
+		AddrType a0, AddrType a1, AddrType a2)
+	{
+		// claim a free slot, see Vyukov's bounded MPMC queue
+		size_t pos = head_.load(boost::memory_order_relaxed);
+		slot *s;
+		for(;;){
+			s = &ring_[pos & mask_];
+			size_t seq = s->seq.load(boost::memory_order_acquire);
+			if(seq == pos){
+				if(head_.compare_exchange_weak(pos, pos + 1,
+					boost::memory_order_relaxed))
+					break;
+			}else if((ptrdiff_t)(seq - pos) < 0){ // full
+				dropped_.fetch_add(1, boost::memory_order_relaxed);
+				return;
+			}else
+				pos = head_.load(boost::memory_order_relaxed);
+		}
+
+		access_record &r = s->rec;
+		r.op = op;
+		r.arg[0] = a0;
+		r.arg[1] = a1;
+		r.arg[2] = a2;
+		r.time = real_base_ + (t0 - mono_base_);
+		r.latency = (lat > 0xffffffffu) ? 0xffffffffu : (boost::uint32_t)lat;
+		r.reserved = 0;
+		s->seq.store(pos + 1, boost::memory_order_release);
+	}
+
+	size_t
+	access_log::pop(access_record *buf, size_t max)
+	{
+		size_t cnt(0);
+		while(cnt < max){
+			slot &s = ring_[tail_ & mask_];
+			if(s.seq.load(boost::memory_order_acquire) != tail_ + 1)
+				break;
+			buf[cnt++] = s.rec;
+			s.seq.store(tail_ + mask_ + 1, boost::memory_order_release);
+			++tail_;
+		}
+		return cnt;
+	}
+
+	void
+	access_log::run()
+	{
+		access_record buf[ACCESS_LOG_BATCH];
+		for(;;){
+			bool stopping = stop_.load(boost::memory_order_acquire);
+			size_t cnt = pop(buf, ACCESS_LOG_BATCH);
+
+			size_t dropped = dropped_.load(boost::memory_order_relaxed);
+			if(dropped != dropped_logged_ && cnt < ACCESS_LOG_BATCH){
+				access_record &r = buf[cnt++];
+				memset(&r, 0, sizeof(r));
+				r.op = ACC_DROPPED;
+				r.arg[0] = dropped - dropped_logged_;
+				r.time = real_base_ + (now() - mono_base_);
+				dropped_logged_ = dropped;
+			}
+
+			if(cnt){
+				fwrite(buf, sizeof(access_record), cnt, file_);
+				continue;
+			}
+			fflush(file_);
+			if(stopping) return;
+			boost::this_thread::sleep(
+				boost::posix_time::milliseconds(ACCESS_LOG_IDLE_MS));
+		}
+	}
+
+} // end of namespace BDB
@@ -0,0 +1,101 @@
+#ifndef _BDB_ACCESS_LOG_HPP
+#define _BDB_ACCESS_LOG_HPP
+
+#include "access_rec.hpp"
+#include "common.hpp"
+#include "boost/atomic.hpp"
+#include "boost/thread/thread.hpp"
+#include <cstdio>
+
+// Records written by one fwrite of the background writer
+#define ACCESS_LOG_BATCH 256
+
+// Sleep of the background writer when the ring is empty, in ms
+#define ACCESS_LOG_IDLE_MS 10
+
+namespace BDB {
+
+	/** @brief Binary access log drained by a background writer
+	 *  @details Operations push fixed-size access_record into a
+	 *  bounded lock-free ring; a writer thread drains it to the file
+	 *  in batches. Records that find the ring full are dropped and
+	 *  counted, the count is written as an ACC_DROPPED record.
+	 *  Only one of every sample operations is recorded.
+	 */
+	class access_log
+	{
+	public:
+		access_log();
+
+		/// Stop the writer after draining the ring
+		~access_log();
+
+		/** @brief Open a log file and start the writer
+		 *  @param fname Appended to. The magic is written if empty.
+		 *  @param capacity Records in the ring, rounded up to a
+		 *  power of 2.
+		 *  @param sample Record one of every sample operations.
+		 *  @throw std::runtime_error
+		 */
+		void
+		open(char const* fname, size_t capacity, unsigned int sample);
+
+		/// Record an operation started at t0 that took lat ns
+		void
+		record(unsigned int op, boost::uint64_t t0, boost::uint64_t lat,
+			AddrType a0=0, AddrType a1=0, AddrType a2=0)
+		{
+			if(0 == ring_) return;
+			if(1 < sample_ &&
+				0 != tick_.fetch_add(1, boost::memory_order_relaxed) % sample_)
+				return;
+			push(op, t0, lat, a0, a1, a2);
+		}
+
+		/// Records dropped so far
+		size_t
+		dropped() const
+		{ return dropped_.load(boost::memory_order_relaxed); }
+
+		/// Monotonic time in ns
+		static boost::uint64_t
+		now();
+
+	private:
+		access_log(access_log const &cp);
+		access_log& operator=(access_log const &cp);
+
+		struct slot
+		{
+			boost::atomic<size_t> seq;
+			access_record rec;
+		};
+
+		void
+		push(unsigned int op, boost::uint64_t t0, boost::uint64_t lat,
+			AddrType a0, AddrType a1, AddrType a2);
+
+		// move ready records to buf; only called by the writer
+		size_t
+		pop(access_record *buf, size_t max);
+
+		void
+		run();
+
+		slot *ring_;
+		size_t mask_;
+		unsigned int sample_;
+		boost::atomic<size_t> head_; // next slot to fill
+		size_t tail_; // next slot to drain, owned by the writer
+		boost::atomic<size_t> tick_;
+		boost::atomic<size_t> dropped_;
+		size_t dropped_logged_;
+		boost::atomic<bool> stop_;
+		boost::uint64_t mono_base_, real_base_;
+		FILE *file_;
+		boost::thread writer_;
+	};
+
+} // end of namespace BDB
+
+#endif // end of header
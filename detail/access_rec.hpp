@@ -0,0 +1,66 @@
+#ifndef _BDB_ACCESS_REC_HPP
+#define _BDB_ACCESS_REC_HPP
+
+#include "boost/cstdint.hpp"
+
+// First bytes of a binary access log
+#define ACCESS_LOG_MAGIC "BDBALOG1"
+#define ACCESS_LOG_MAGIC_LEN 8
+
+namespace BDB {
+
+	/// Operations recorded in access logs
+	enum access_op {
+		ACC_PUT = 0, ACC_PUT_BATCH, ACC_INSERT, ACC_APPENDV, ACC_APPEND,
+		ACC_UPDATE_PUT, ACC_UPDATE, ACC_GET, ACC_GETV, ACC_VIEW, ACC_SEND,
+		ACC_GET_BATCH, ACC_STRING_GET, ACC_DEL, ACC_DEL_BATCH,
+		ACC_DEL_RANGE, ACC_PARTIAL_DEL, ACC_OSTREAM, ACC_OSTREAM_INS,
+		ACC_DROPPED, // arg[0] records were dropped on overflow
+		ACC_OP_CNT
+	};
+
+	/** @brief Fixed-size record of a binary access log
+	 *  @details Arguments follow the order of the text format, see
+	 *  concepts/access-log-fmt.markdown; unused ones are 0. Records
+	 *  are written in host byte order.
+	 */
+	struct access_record
+	{
+		boost::uint32_t op;
+		boost::uint32_t arg[3];
+		boost::uint64_t time;    // start, ns since the Unix epoch
+		boost::uint32_t latency; // ns, saturated
+		boost::uint32_t reserved;
+	};
+
+	/// Name of an operation in the text format
+	inline char const*
+	access_op_name(unsigned int op)
+	{
+		static char const* names[ACC_OP_CNT] = {
+			"put", "put_batch", "insert", "appendv", "append",
+			"update_put", "update", "get", "getv", "view", "send",
+			"get_batch", "string_get", "del", "del_batch",
+			"del_range", "partial_del", "ostream", "ostream_ins",
+			"dropped"
+		};
+		return (op < ACC_OP_CNT) ? names[op] : "unknown";
+	}
+
+	/// Number of arguments of an operation in the text format
+	inline unsigned int
+	access_op_arity(unsigned int op)
+	{
+		static unsigned char const arity[ACC_OP_CNT] = {
+			1, 2, 3, 2, 2,
+			2, 2, 3, 3, 3, 3,
+			2, 3, 1, 2,
+			3, 3, 1, 3,
+			1
+		};
+		return (op < ACC_OP_CNT) ? arity[op] : 0;
+	}
+
+} // end of namespace BDB
+
+#endif // end of header
@@ -31,6 +31,7 @@ namespace BDB {
 			throw std::logic_error("AddrIterator: No BehaviorDB instance, "
 				"you should use iter = bdb.begin().");
 
+		opt_lock_guard glk(bdb_->gid_mutex_);
 		cur_ = bdb_->global_id_->next_used(cur_+1);
 		return *this;
 	}
@@ -42,6 +43,7 @@ namespace BDB {
 			throw std::logic_error("AddrIterator: No BehaviorDB instance, "
 				"you should use iter = bdb.begin().");
 
+		opt_lock_guard glk(bdb_->gid_mutex_);
 		if( !bdb_->global_id_->isAcquired(cur_) )
 			throw std::out_of_range("AddrIterator: Iterator is invalid");
 
@@ -0,0 +1,344 @@
+#include "async.hpp"
+#include "bdb.hpp"
+#include "stream_state.hpp"
+#include "boost/thread/thread.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/shared_ptr.hpp"
+#include "boost/functional/hash.hpp"
+#include "boost/atomic.hpp"
+#include "boost/bind.hpp"
+#include <deque>
+#include <vector>
+
+namespace BDB {
+
+	typedef boost::function<void()> Job;
+
+	struct AsyncImpl
+	{
+		// a thread with its own FIFO queue
+		struct worker
+		{
+			worker(): stop(false) {}
+
+			boost::thread thr;
+			boost::mutex mutex;
+			boost::condition_variable cond;
+			std::deque<Job> queue;
+			bool stop;
+		};
+
+		AsyncImpl(BehaviorDB &bdb, unsigned int workers);
+		~AsyncImpl();
+
+		void
+		run(worker *w);
+
+		void
+		submit(unsigned int w, Job const& job);
+
+		// same address always goes to the same worker
+		unsigned int
+		route(AddrType addr) const
+		{ return addr % workers.size(); }
+
+		unsigned int
+		route(stream_state const* state) const
+		{
+			if(state && state->existed) return route(state->ext_addr);
+			return boost::hash<void const*>()(state) % workers.size();
+		}
+
+		// new data have no address yet
+		unsigned int
+		route_any()
+		{ return rr.fetch_add(1, boost::memory_order_relaxed) % workers.size(); }
+
+		BehaviorDB &bdb;
+		std::vector<worker*> workers;
+		boost::atomic<unsigned int> rr;
+	};
+
+	AsyncImpl::AsyncImpl(BehaviorDB &bdb, unsigned int cnt)
+	: bdb(bdb), rr(0)
+	{
+		if(0 == cnt) cnt = 1;
+		for(unsigned int i=0; i<cnt; ++i){
+			workers.push_back(new worker);
+			workers.back()->thr =
+				boost::thread(&AsyncImpl::run, this, workers.back());
+		}
+	}
+
+	AsyncImpl::~AsyncImpl()
+	{
+		for(size_t i=0; i<workers.size(); ++i){
+			{
+				boost::lock_guard<boost::mutex> lk(workers[i]->mutex);
+				workers[i]->stop = true;
+			}
+			workers[i]->cond.notify_one();
+		}
+		for(size_t i=0; i<workers.size(); ++i){
+			workers[i]->thr.join();
+			delete workers[i];
+		}
+	}
+
+	void
+	AsyncImpl::run(worker *w)
+	{
+		Job job;
+		while(true){
+			{
+				boost::unique_lock<boost::mutex> lk(w->mutex);
+				while(w->queue.empty() && !w->stop)
+					w->cond.wait(lk);
+				// drain queue before stopping
+				if(w->queue.empty()) return;
+				job.swap(w->queue.front());
+				w->queue.pop_front();
+			}
+			job();
+		}
+	}
+
+	void
+	AsyncImpl::submit(unsigned int w, Job const& job)
+	{
+		{
+			boost::lock_guard<boost::mutex> lk(workers[w]->mutex);
+			workers[w]->queue.push_back(job);
+		}
+		workers[w]->cond.notify_one();
+	}
+
+	namespace {
+
+		// run an operation, notify handler then fulfill promise
+		template<typename R, typename H>
+		struct task
+		{
+			boost::shared_ptr<boost::promise<R> > p;
+			boost::function<R()> op;
+			H h;
+
+			void
+			operator()()
+			{
+				try{
+					R rt = op();
+					if(h) h(rt);
+					p->set_value(rt);
+				}catch(...){
+					p->set_exception(boost::current_exception());
+				}
+			}
+		};
+
+		template<typename R, typename H>
+		boost::unique_future<R>
+		post(AsyncImpl *impl, unsigned int w,
+			boost::function<R()> const& op, H const& h)
+		{
+			task<R, H> t;
+			t.p.reset(new boost::promise<R>);
+			t.op = op;
+			t.h = h;
+			boost::unique_future<R> rt = t.p->get_future();
+			impl->submit(w, t);
+			return boost::move(rt);
+		}
+
+		// ---- operations bound into tasks ----
+
+		AddrType
+		do_put(BehaviorDB *bdb, std::string const& data)
+		{ return bdb->put(data); }
+
+		AddrType
+		do_put_at(BehaviorDB *bdb, std::string const& data,
+			AddrType addr, size_t off)
+		{ return bdb->put(data, addr, off); }
+
+		AddrType
+		do_update(BehaviorDB *bdb, std::string const& data, AddrType addr)
+		{ return bdb->update(data, addr); }
+
+		std::string
+		do_get(BehaviorDB *bdb, AddrType addr, size_t max, size_t off)
+		{
+			std::string rt;
+			bdb->get(&rt, max, addr, off);
+			return rt;
+		}
+
+		size_t
+		do_del(BehaviorDB *bdb, AddrType addr)
+		{ return bdb->del(addr); }
+
+		stream_state const*
+		do_ostream(BehaviorDB *bdb, size_t stream_size)
+		{ return bdb->ostream(stream_size); }
+
+		stream_state const*
+		do_ostream_at(BehaviorDB *bdb, size_t stream_size,
+			AddrType addr, size_t off)
+		{ return bdb->ostream(stream_size, addr, off); }
+
+		stream_state const*
+		do_istream(BehaviorDB *bdb, size_t stream_size,
+			AddrType addr, size_t off)
+		{ return bdb->istream(stream_size, addr, off); }
+
+		stream_state const*
+		do_stream_write(BehaviorDB *bdb, stream_state const* state,
+			std::string const& data)
+		{ return bdb->stream_write(state, data.data(), data.size()); }
+
+		std::string
+		do_stream_read(BehaviorDB *bdb, stream_state const* state, size_t size)
+		{
+			std::string rt;
+			size_t left = state->size - state->used;
+			rt.resize(size < left ? size : left);
+			if(!rt.empty()){
+				state = bdb->stream_read(state, &rt[0], rt.size());
+				if(0 == state || state->error)
+					rt.clear();
+			}
+			return rt;
+		}
+
+		AddrType
+		do_stream_finish(BehaviorDB *bdb, stream_state const* state)
+		{ return bdb->stream_finish(state); }
+
+		struct abort_task
+		{
+			boost::shared_ptr<boost::promise<void> > p;
+			BehaviorDB *bdb;
+			stream_state const* state;
+
+			void
+			operator()()
+			{
+				bdb->stream_abort(state);
+				p->set_value();
+			}
+		};
+
+	} // end of anonymous namespace
+
+	// ---- AsyncBehaviorDB ----
+
+	AsyncBehaviorDB::AsyncBehaviorDB(BehaviorDB &bdb, unsigned int workers)
+	: impl_(new AsyncImpl(bdb, workers))
+	{}
+
+	AsyncBehaviorDB::~AsyncBehaviorDB()
+	{ delete impl_; }
+
+	boost::unique_future<AddrType>
+	AsyncBehaviorDB::async_put(std::string const& data, addr_handler h)
+	{
+		return post<AddrType>(impl_, impl_->route_any(),
+			boost::bind(&do_put, &impl_->bdb, data), h);
+	}
+
+	boost::unique_future<AddrType>
+	AsyncBehaviorDB::async_put(std::string const& data, AddrType addr,
+		size_t off, addr_handler h)
+	{
+		return post<AddrType>(impl_, impl_->route(addr),
+			boost::bind(&do_put_at, &impl_->bdb, data, addr, off), h);
+	}
+
+	boost::unique_future<AddrType>
+	AsyncBehaviorDB::async_update(std::string const& data, AddrType addr,
+		addr_handler h)
+	{
+		return post<AddrType>(impl_, impl_->route(addr),
+			boost::bind(&do_update, &impl_->bdb, data, addr), h);
+	}
+
+	boost::unique_future<std::string>
+	AsyncBehaviorDB::async_get(AddrType addr, size_t max, size_t off,
+		data_handler h)
+	{
+		return post<std::string>(impl_, impl_->route(addr),
+			boost::bind(&do_get, &impl_->bdb, addr, max, off), h);
+	}
+
+	boost::unique_future<size_t>
+	AsyncBehaviorDB::async_del(AddrType addr, size_handler h)
+	{
+		return post<size_t>(impl_, impl_->route(addr),
+			boost::bind(&do_del, &impl_->bdb, addr), h);
+	}
+
+	boost::unique_future<stream_state const*>
+	AsyncBehaviorDB::async_ostream(size_t stream_size, state_handler h)
+	{
+		return post<stream_state const*>(impl_, impl_->route_any(),
+			boost::bind(&do_ostream, &impl_->bdb, stream_size), h);
+	}
+
+	boost::unique_future<stream_state const*>
+	AsyncBehaviorDB::async_ostream(size_t stream_size, AddrType addr,
+		size_t off, state_handler h)
+	{
+		return post<stream_state const*>(impl_, impl_->route(addr),
+			boost::bind(&do_ostream_at, &impl_->bdb, stream_size, addr, off), h);
+	}
+
+	boost::unique_future<stream_state const*>
+	AsyncBehaviorDB::async_istream(size_t stream_size, AddrType addr,
+		size_t off, state_handler h)
+	{
+		return post<stream_state const*>(impl_, impl_->route(addr),
+			boost::bind(&do_istream, &impl_->bdb, stream_size, addr, off), h);
+	}
+
+	boost::unique_future<stream_state const*>
+	AsyncBehaviorDB::async_stream_write(stream_state const* state,
+		std::string const& data, state_handler h)
+	{
+		return post<stream_state const*>(impl_, impl_->route(state),
+			boost::bind(&do_stream_write, &impl_->bdb, state, data), h);
+	}
+
+	boost::unique_future<std::string>
+	AsyncBehaviorDB::async_stream_read(stream_state const* state, size_t size,
+		data_handler h)
+	{
+		return post<std::string>(impl_, impl_->route(state),
+			boost::bind(&do_stream_read, &impl_->bdb, state, size), h);
+	}
+
+	boost::unique_future<AddrType>
+	AsyncBehaviorDB::async_stream_finish(stream_state const* state,
+		addr_handler h)
+	{
+		return post<AddrType>(impl_, impl_->route(state),
+			boost::bind(&do_stream_finish, &impl_->bdb, state), h);
+	}
+
+	boost::unique_future<void>
+	AsyncBehaviorDB::async_stream_abort(stream_state const* state)
+	{
+		abort_task t;
+		t.p.reset(new boost::promise<void>);
+		t.bdb = &impl_->bdb;
+		t.state = state;
+		boost::unique_future<void> rt = t.p->get_future();
+		impl_->submit(impl_->route(state), t);
+		return boost::move(rt);
+	}
+
+	unsigned int
+	AsyncBehaviorDB::workers() const
+	{ return impl_->workers.size(); }
+
+} // end of namespace BDB
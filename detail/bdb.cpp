@@ -1,6 +1,7 @@
 #include "bdb.hpp"
 #include "bdbImpl.hpp"
 #include "addr_iter.hpp"
+#include "buf_pool.hpp"
 
 namespace BDB {
 	
@@ -30,6 +31,26 @@ namespace BDB {
 	BehaviorDB::put(std::string const& data, AddrType addr, size_t off)
 	{ return impl_->put(data, addr, off); }
 
+	size_t
+	BehaviorDB::put_batch(Segment const* segs, size_t cnt, AddrType *addrs)
+	{ return impl_->put_batch(segs, cnt, addrs); }
+
+	AddrType
+	BehaviorDB::putv(Segment const* segs, size_t cnt)
+	{ return impl_->putv(segs, cnt); }
+
+	AddrType
+	BehaviorDB::appendv(Segment const* segs, size_t cnt, AddrType addr)
+	{ return impl_->appendv(segs, cnt, addr); }
+
+	AddrType
+	BehaviorDB::put_from_fd(int fd, size_t size)
+	{ return impl_->put_from_fd(fd, size); }
+
+	size_t
+	BehaviorDB::append(WriteVector const* wvs, size_t cnt)
+	{ return impl_->append(wvs, cnt); }
+
 	AddrType
 	BehaviorDB::update(char const* data, size_t size, AddrType addr)
 	{ return impl_->update(data, size, addr); }
@@ -41,15 +62,45 @@ namespace BDB {
 	size_t
 	BehaviorDB::get(char *output, size_t size, AddrType addr, size_t off)
 	{ return impl_->get(output, size, addr, off); }
+
+	size_t
+	BehaviorDB::getv(MutableSegment const* segs, size_t cnt, AddrType addr, 
+		size_t off)
+	{ return impl_->getv(segs, cnt, addr, off); }
+
+	size_t
+	BehaviorDB::get_batch(AddrType const* addrs, size_t cnt, 
+		char* const* buffers, size_t *sizes)
+	{ return impl_->get_batch(addrs, cnt, buffers, sizes); }
 	
 	size_t
 	BehaviorDB::get(std::string *output, size_t max, AddrType addr, size_t off)
 	{ return impl_->get(output, max, addr, off); }
 
+	View
+	BehaviorDB::view(AddrType addr, size_t off, size_t size)
+	{ return impl_->view(addr, off, size); }
+
+	void
+	BehaviorDB::release(View const& v)
+	{ impl_->release(v); }
+
+	size_t
+	BehaviorDB::send_to_fd(AddrType addr, int fd, size_t off, size_t size)
+	{ return impl_->send_to_fd(addr, fd, off, size); }
+
 	size_t
 	BehaviorDB::del(AddrType addr)
 	{ return impl_->del(addr); }
 
+	size_t
+	BehaviorDB::del_batch(AddrType const* addrs, size_t cnt)
+	{ return impl_->del_batch(addrs, cnt); }
+
+	size_t
+	BehaviorDB::del_range(AddrType first, AddrType last)
+	{ return impl_->del_range(first, last); }
+
 	size_t
 	BehaviorDB::del(AddrType addr, size_t off, size_t size)
 	{ return impl_->del(addr, off, size); }
@@ -74,6 +125,10 @@ namespace BDB {
 	BehaviorDB::stream_read(stream_state const* state, char* output, size_t size)
 	{ return impl_->stream_read(state, output, size); }
 
+	stream_state const*
+	BehaviorDB::stream_write_from_fd(stream_state const* state, int fd, size_t size)
+	{ return impl_->stream_write_from_fd(state, fd, size); }
+
 	AddrType
 	BehaviorDB::stream_finish(stream_state const* state)
 	{ return impl_->stream_finish(state); }
@@ -82,6 +137,10 @@ namespace BDB {
 	BehaviorDB::stream_pause(stream_state const* state)
 	{ return impl_->stream_pause(state); }
 
+	stream_state const*
+	BehaviorDB::stream_buffer(stream_state const* state, size_t size)
+	{ return impl_->stream_buffer(state, size); }
+
 	stream_state const*
 	BehaviorDB::stream_resume(size_t encrypt_handle)
 	{ return impl_->stream_resume(encrypt_handle); }
@@ -105,5 +164,13 @@ namespace BDB {
 	void
 	BehaviorDB::stat(Stat *s) const
 	{ impl_->stat(s); }
+
+	void
+	BehaviorDB::metrics(std::string *out) const
+	{ impl_->metrics(out); }
+
+	void
+	BehaviorDB::buffer_retention(size_t bytes)
+	{ buf_pool::instance().retention(bytes); }
 } // end of namespace BDB
 
@@ -5,20 +5,56 @@
 #include "addr_iter.hpp"
 #include "stat.hpp"
 #include "stream_state.hpp"
+#include "sys_io.hpp"
+#include "metrics.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <new>
 #include <stdexcept>
 #include <ios>
+#include <map>
 #include <sstream>
+#include <vector>
 
 
 
 namespace BDB {
 	
+	namespace {
+
+		// address lock stripes marked in need, locked in ascending order
+		struct stripe_lock
+		{
+			stripe_lock(opt_mutex *stripes, std::vector<char> const& need)
+			: stripes(stripes), need(need)
+			{
+				for(size_t i=0; i<need.size(); ++i)
+					if(need[i]) stripes[i].lock();
+			}
+
+			~stripe_lock()
+			{
+				for(size_t i=need.size(); i>0; --i)
+					if(need[i-1]) stripes[i-1].unlock();
+			}
+
+			opt_mutex *stripes;
+			std::vector<char> const& need;
+		};
+
+	} // end of anonymous namespace
+	
 	BDBImpl::BDBImpl(Config const & conf)
-	: pools_(0), err_log_(0), acc_log_(0), global_id_(0)
+	: pools_(0), err_log_(0), global_id_(0),
+	  stream_buf_size_(conf.stream_buf_size), next_handle_(1), stream_log_(0),
+	  limbo_(LIMBO_INIT), metrics_interval_(0)
 	{
 		using namespace std;
 
+		for(int i=0; i<Stat::ERROR_SLOTS; ++i)
+			err_cnt_[i].store(0, boost::memory_order_relaxed);
+
 		conf.validate();
 		
 		init_(conf); 
@@ -26,11 +62,28 @@ namespace BDB {
 	
 	BDBImpl::~BDBImpl()
 	{
+		if(metrics_writer_.joinable()){
+			metrics_writer_.interrupt();
+			metrics_writer_.join();
+		}
+
+		// no reader is left
+		while(pools_ && !limbo_.empty()){
+			AddrType internal_addr = limbo_.front().second;
+			pools_[addrEval.addr_to_dir(internal_addr)].free(
+				addrEval.local_addr(internal_addr));
+			limbo_.pop_front();
+		}
+
 		delete global_id_;
 
-		if(acc_log_) fclose(acc_log_);
+		if(stream_log_) fclose(stream_log_);
 		if(err_log_) fclose(err_log_);
 
+#ifdef BDB_PROFILE
+		profile_dump(stderr);
+#endif
+
 		if(!pools_) return;
 		for(unsigned int i =0; i<addrEval.dir_count(); ++i)
 			pools_[i].~pool();
@@ -60,12 +113,14 @@ namespace BDB {
 		pcfg.work_dir = (*conf.pool_dir) ? conf.pool_dir : conf.root_dir;
 		pcfg.trans_dir =(*conf.trans_dir) ?  conf.trans_dir : conf.root_dir;
 		pcfg.header_dir = (*conf.header_dir) ? conf.header_dir : conf.root_dir;
+		pcfg.concurrent = conf.concurrent;
 
 		pools_ = (pool*)malloc(sizeof(pool) * addrEval.dir_count());
 		for(unsigned int i =0; i<addrEval.dir_count(); ++i){
 			pcfg.dirID = i;
 			new (&pools_[i]) pool(pcfg, addrEval); 
 		}
+		lat_stat_.init(addrEval.dir_count());
 
 		// init logs
 		char fname[256] = {};
@@ -81,25 +136,202 @@ namespace BDB {
 			if(0 != setvbuf(err_log_, err_log_buf_, _IOLBF, 256))
 				throw std::runtime_error("setvbuf to log file failed\n");
 			
-			sprintf(fname, "%saccess.log", log_dir);
-			if(0 == (acc_log_ = fopen(fname, "ab")))
-				throw std::runtime_error("create access log file failed\n");
-		
-			if(0 != setvbuf(acc_log_, acc_log_buf_, _IOFBF, 4096))
-				throw std::runtime_error("setvbuf to log file failed\n");
+			if(conf.access_log_sample){
+				sprintf(fname, "%saccess.log", log_dir);
+				acc_log_.open(fname, conf.access_log_ring, conf.access_log_sample);
+			}
+			
+			sprintf(fname, "%smetrics.prom", log_dir);
+			metrics_file_ = fname;
 		}
 
 		// init IDValPool
 		sprintf(fname, "%sglobal_id.trans", conf.root_dir);
 		global_id_ = new IDValPool(fname, conf.beg, conf.end);
+
+		// paused streams and chunks left by a crash
+		sprintf(fname, "%sstream.trans", pcfg.trans_dir);
+		init_streams(fname);
+		reclaim_orphans();
+
+		for(unsigned int i=0; i<ADDR_LOCK_CNT; ++i)
+			addr_mutex_[i].enable(conf.concurrent);
+		stream_mutex_.enable(conf.concurrent);
+		gid_mutex_.enable(conf.concurrent);
+		limbo_mutex_.enable(conf.concurrent);
+		log_mutex_.enable(conf.concurrent);
+
+		metrics_interval_ = conf.metrics_interval;
+		if(metrics_interval_ && !metrics_file_.empty())
+			metrics_writer_ = boost::thread(&BDBImpl::write_metrics, this);
+	}
+
+	AddrType
+	BDBImpl::find(AddrType addr) const
+	{
+		PROFILE_SCOPE(PROF_ADDR);
+		return global_id_->Find(addr);
+	}
+
+	void
+	BDBImpl::retire(AddrType internal_addr)
+	{
+		unsigned int dir = addrEval.addr_to_dir(internal_addr);
+		AddrType loc_addr = addrEval.local_addr(internal_addr);
+
+		// stream readers keep the chunk till the last one finishes
+		{
+			opt_lock_guard slk(stream_mutex_);
+			if(in_reading_.end() != in_reading_.find(internal_addr)){
+				pools_[dir].pine(loc_addr);
+				return;
+			}
+		}
+		opt_lock_guard llk(limbo_mutex_);
+		to_limbo(internal_addr);
+	}
+
+	void
+	BDBImpl::retire(std::vector<AddrType> &internal_addrs)
+	{
+		// lock each pool once
+		std::sort(internal_addrs.begin(), internal_addrs.end());
+		size_t beg(0);
+		while(beg < internal_addrs.size()){
+			unsigned int dir = addrEval.addr_to_dir(internal_addrs[beg]);
+			opt_lock_guard plk(pools_[dir].mutex());
+			for(; beg < internal_addrs.size() && 
+				dir == addrEval.addr_to_dir(internal_addrs[beg]); ++beg)
+				retire(internal_addrs[beg]);
+		}
+	}
+
+	AddrType
+	BDBImpl::begin_reading(AddrType addr, ChunkHeader *header)
+	{
+		opt_lock_guard alk(addr_mutex(addr));
+
+		AddrType internal_addr;
+		{
+			opt_lock_guard glk(gid_mutex_);
+			PROFILE_SCOPE(PROF_ADDR);
+			if(!global_id_->isAcquired(addr) || global_id_->isLocked(addr))
+				return -1;
+			internal_addr = global_id_->Find(addr); 
+		}
+
+		unsigned int dir = addrEval.addr_to_dir(internal_addr);
+		{
+			opt_lock_guard plk(pools_[dir].mutex());
+			if(-1 == pools_[dir].head(header, addrEval.local_addr(internal_addr))){
+				error(dir);
+				return -1;
+			}
+		}
+
+		opt_lock_guard slk(stream_mutex_);
+		++in_reading_[internal_addr];
+		return internal_addr;
+	}
+
+	void
+	BDBImpl::end_reading(AddrType internal_addr)
+	{
+		unsigned int dir = addrEval.addr_to_dir(internal_addr);
+		AddrType loc_addr = addrEval.local_addr(internal_addr);
+
+		opt_lock_guard plk(pools_[dir].mutex());
+		opt_lock_guard slk(stream_mutex_);
+
+		AddrCntCont::iterator iter = in_reading_.find(internal_addr);
+		assert(in_reading_.end() != iter && "unexpected address");
+
+		if(0 == --iter->second){ // the last reader
+			// retire() pinned it instead of freeing
+			if(pools_[dir].is_pinned(loc_addr)){
+				// get() may still be reading it
+				pools_[dir].unpine(loc_addr);
+				opt_lock_guard llk(limbo_mutex_);
+				to_limbo(internal_addr);
+			}
+			in_reading_.erase(iter);
+		}
+	}
+
+	void
+	BDBImpl::reclaim()
+	{
+		AddrType addrs[RECLAIM_BATCH];
+		size_t cnt(RECLAIM_BATCH);
+		while(RECLAIM_BATCH == cnt){
+			cnt = 0;
+			{
+				opt_lock_guard llk(limbo_mutex_);
+				if(limbo_.empty()) return;
+				epoch_.advance();
+				while(cnt < RECLAIM_BATCH && !limbo_.empty() && 
+					epoch_.safe(limbo_.front().first))
+				{
+					addrs[cnt++] = limbo_.front().second;
+					limbo_.pop_front();
+				}
+			}
+			
+			// one free per pool; sorted by pool then position
+			std::sort(addrs, addrs + cnt);
+			size_t beg(0);
+			while(beg < cnt){
+				unsigned int dir = addrEval.addr_to_dir(addrs[beg]);
+				size_t end = beg + 1;
+				while(end < cnt && dir == addrEval.addr_to_dir(addrs[end]))
+					++end;
+				for(size_t i=beg; i<end; ++i)
+					addrs[i] = addrEval.local_addr(addrs[i]);
+				
+				opt_lock_guard plk(pools_[dir].mutex());
+				if((size_t)-1 == pools_[dir].free(addrs + beg, end - beg))
+					error(dir);
+				beg = end;
+			}
+		}
+	}
+
+	void
+	BDBImpl::lock_also(opt_unique_lock &held, unsigned int held_dir,
+		opt_unique_lock &other, unsigned int other_dir)
+	{
+		if(held_dir == other_dir) return;
+		if(held_dir < other_dir){
+			other.lock();
+			return;
+		}
+		// keep ascending order; chunks refered by held are
+		// still protected by the address lock of callers
+		held.unlock();
+		other.lock();
+		held.lock();
 	}
 	
 	AddrType
 	BDBImpl::put(char const *data, size_t size)
 	{
+		Segment seg = { data, size };
+		return putv(&seg, 1);
+	}
+
+	AddrType
+	BDBImpl::putv(Segment const* segs, size_t cnt)
+	{
+		boost::uint64_t t0 = access_log::now();
 		// assert(0 != *this && "BDBImpl is not proper initiated");
 		
-		if(!global_id_->avail()){
+		size_t size(0);
+		for(size_t i=0; i<cnt; ++i)
+			size += segs[i].size;
+		TRACE_OP_SCOPE(ACC_PUT, -1, size);
+		PROFILE_SCOPE(PROF_OP);
+
+		if(full()){
 			error(ADDRESS_OVERFLOW, __LINE__);
 			return -1;
 		}
@@ -111,7 +343,10 @@ namespace BDB {
 		}
 		AddrType rt(0), loc_addr(0);
 		while(dir < addrEval.dir_count()){
-			loc_addr = pools_[dir].write(data, size);
+			opt_lock_guard plk(pools_[dir].mutex());
+			loc_addr = (1 == cnt) ? 
+				pools_[dir].write(segs[0].data, size) :
+				pools_[dir].writev(segs, cnt);
 			if(loc_addr != -1)	break;
 			dir++;
 		}
@@ -122,34 +357,254 @@ namespace BDB {
 		}
 
 		rt = addrEval.global_addr(dir, loc_addr);
+		
+		opt_unique_lock glk(gid_mutex_);
 		rt = global_id_->Acquire(rt);
-
-		assert(-1 != rt && "Unexpected return value");
+		
+		if((AddrType)-1 == rt){ // taken by others since the check above
+			glk.unlock();
+			opt_lock_guard plk(pools_[dir].mutex());
+			pools_[dir].free(loc_addr);
+			error(ADDRESS_OVERFLOW, __LINE__);
+			return -1;
+		}
 		
 		if( !global_id_->Commit(rt) ){
+			glk.unlock();
 			error(COMMIT_FAILURE, __LINE__);
 			return -1;
 		}
+		glk.unlock();
 		
-		fprintf(acc_log_, "%-12s\t%08x\n", "put", size);
+		done(ACC_PUT, STAT_PUT, dir, t0, size);
 
 		return rt;
 	}
 
 
+	size_t
+	BDBImpl::put_batch(Segment const* segs, size_t cnt, AddrType *addrs)
+	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_PUT_BATCH, -1, 0);
+		PROFILE_SCOPE(PROF_OP);
+		// group by destination pool
+		std::vector<std::vector<size_t> > idx(addrEval.dir_count());
+		for(size_t i=0; i<cnt; ++i){
+			addrs[i] = -1;
+			unsigned int dir = addrEval.directory(segs[i].size);
+			if((unsigned int)-1 == dir){
+				error(DATA_TOO_BIG, __LINE__);
+				continue;
+			}
+			idx[dir].push_back(i);
+		}
+		
+		std::vector<Segment> grp;
+		std::vector<AddrType> loc, ids;
+		std::vector<size_t> pos;
+		bool committed(true);
+		for(unsigned int dir=0; dir<idx.size(); ++dir){
+			if(idx[dir].empty()) continue;
+			size_t n = idx[dir].size();
+			grp.resize(n);
+			loc.resize(n);
+			for(size_t i=0; i<n; ++i)
+				grp[i] = segs[idx[dir][i]];
+			
+			opt_lock_guard plk(pools_[dir].mutex());
+			if(0 == pools_[dir].write(&grp[0], n, &loc[0]))
+				error(dir);
+			
+			opt_unique_lock glk(gid_mutex_);
+			ids.clear();
+			pos.clear();
+			for(size_t i=0; i<n; ++i){
+				if((AddrType)-1 == loc[i]) continue;
+				AddrType rt = global_id_->Acquire(
+					addrEval.global_addr(dir, loc[i]));
+				if((AddrType)-1 == rt){ // out of global IDs
+					pools_[dir].free(loc[i]);
+					continue;
+				}
+				addrs[idx[dir][i]] = rt;
+				ids.push_back(rt);
+				pos.push_back(i);
+			}
+			if(!ids.empty() && !global_id_->Commit(&ids[0], ids.size())){
+				// not in the log, so undo them as if never put
+				for(size_t i=0; i<ids.size(); ++i){
+					global_id_->Release(ids[i]);
+					pools_[dir].free(loc[pos[i]]);
+					addrs[idx[dir][pos[i]]] = -1;
+				}
+				committed = false;
+				glk.unlock();
+				error(COMMIT_FAILURE, __LINE__);
+			}
+		}
+		
+		// pools that are full fall back to the next ones
+		size_t rt(0);
+		for(size_t i=0; i<cnt; ++i){
+			if(committed && (AddrType)-1 == addrs[i] && (unsigned int)-1 != 
+				addrEval.directory(segs[i].size) && !full())
+				addrs[i] = put(segs[i].data, segs[i].size);
+			if((AddrType)-1 != addrs[i]) ++rt;
+		}
+		
+		done(ACC_PUT_BATCH, STAT_PUT, -1, t0, 
+			(unsigned int)cnt, (unsigned int)rt);
+		return rt;
+	}
+
 	AddrType
 	BDBImpl::put(char const* data, size_t size, AddrType addr, size_t off)
 	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_INSERT, addr, size);
+		PROFILE_SCOPE(PROF_OP);
 		// assert(0 != *this && "BDBImpl is not proper initiated");
+		
+		reclaim();
+
+		Segment seg = { data, size };
+		AddrType stale, inter;
+		if((AddrType)-1 == (inter = insert(&seg, 1, addr, off, &stale)) || 
+			!publish(addr, stale))
+			return -1;
+		
+		done(ACC_INSERT, STAT_INSERT, addrEval.addr_to_dir(inter), t0, 
+			size, addr, off);
+
+		return addr;
+	}
+
+	AddrType
+	BDBImpl::appendv(Segment const* segs, size_t cnt, AddrType addr)
+	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_APPENDV, addr, 0);
+		PROFILE_SCOPE(PROF_OP);
+		reclaim();
+
+		AddrType stale, inter;
+		if((AddrType)-1 == (inter = insert(segs, cnt, addr, npos, &stale)) || 
+			!publish(addr, stale))
+			return -1;
+
+		size_t size(0);
+		for(size_t i=0; i<cnt; ++i)
+			size += segs[i].size;
+		done(ACC_APPENDV, STAT_INSERT, addrEval.addr_to_dir(inter), t0, 
+			size, addr);
+		return addr;
+	}
+
+	bool
+	BDBImpl::publish(AddrType addr, AddrType stale)
+	{
+		opt_unique_lock glk(gid_mutex_);
+		if(!global_id_->Commit(addr)){
+			glk.unlock();
+			error(COMMIT_FAILURE, __LINE__);
+			return false;
+		}
+		glk.unlock();
+
+		if((AddrType)-1 != stale){
+			opt_lock_guard plk(pools_[addrEval.addr_to_dir(stale)].mutex());
+			retire(stale);
+		}
+		return true;
+	}
+
+	size_t
+	BDBImpl::append(WriteVector const* wvs, size_t cnt)
+	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_APPEND, -1, 0);
+		PROFILE_SCOPE(PROF_OP);
+		reclaim();
+
+		// same addresses become adjacent and keep their input order
+		typedef std::pair<AddrType, size_t> AddrIdx;
+		std::vector<AddrIdx> order(cnt);
+		for(size_t i=0; i<cnt; ++i)
+			order[i] = AddrIdx(*wvs[i].address, i);
+		std::sort(order.begin(), order.end());
+
+		size_t rt(0);
+		std::vector<AddrType> ids, stales;
+		std::vector<Segment> segs;
+		size_t beg(0);
+		while(beg < cnt){
+			AddrType addr = order[beg].first;
+			size_t end = beg + 1;
+			while(end < cnt && addr == order[end].first)
+				++end;
+			
+			// one write, and at most one migration, per address
+			segs.resize(end - beg);
+			for(size_t i=beg; i<end; ++i){
+				segs[i-beg].data = wvs[order[i].second].buffer;
+				segs[i-beg].size = wvs[order[i].second].size;
+			}
+
+			AddrType stale;
+			if((AddrType)-1 != insert(&segs[0], segs.size(), addr, npos, &stale)){
+				ids.push_back(addr);
+				if((AddrType)-1 != stale) stales.push_back(stale);
+				rt += end - beg;
+			}else{
+				for(size_t i=beg; i<end; ++i)
+					*wvs[order[i].second].address = -1;
+			}
+			beg = end;
+		}
+
+		if(!ids.empty()){
+			opt_unique_lock glk(gid_mutex_);
+			if(!global_id_->Commit(&ids[0], ids.size())){
+				glk.unlock();
+				error(COMMIT_FAILURE, __LINE__);
+				for(size_t i=0; i<cnt; ++i)
+					*wvs[i].address = -1;
+				return 0;
+			}
+		}
+
+		for(size_t i=0; i<stales.size(); ++i){
+			opt_lock_guard plk(pools_[addrEval.addr_to_dir(stales[i])].mutex());
+			retire(stales[i]);
+		}
+
+		done(ACC_APPEND, STAT_INSERT, -1, t0, 
+			(unsigned int)cnt, (unsigned int)rt);
+		return rt;
+	}
+
+	AddrType
+	BDBImpl::insert(Segment const* segs, size_t cnt, AddrType addr, size_t off,
+		AddrType *stale)
+	{
+		assert((1 == cnt || npos == off) && "segments are appended only");
+
+		size_t size(0);
+		for(size_t i=0; i<cnt; ++i)
+			size += segs[i].size;
+
+		opt_lock_guard alk(addr_mutex(addr));
 
 		AddrType internal_addr;
-		if( !global_id_->isAcquired(addr) )
+		if( (AddrType)-1 == (internal_addr = find(addr)) )
 			return -1;
-		internal_addr = global_id_->Find(addr);
 
 		unsigned int dir = addrEval.addr_to_dir(internal_addr);
 		AddrType loc_addr = addrEval.local_addr(internal_addr);
 		AddrType rt;
+		
+		opt_unique_lock plk(pools_[dir].mutex());
 
 		ChunkHeader header;
 		if(-1 == pools_[dir].head(&header, loc_addr)){
@@ -170,22 +625,32 @@ namespace BDB {
 			if(npos == off)
 				off = header.size;
 			
+			opt_unique_lock nlk(pools_[next_dir].mutex(), boost::defer_lock);
+			lock_also(plk, dir, nlk, next_dir);
+
+			size_t moved = header.size;
+
 			// TODO migrate failure 
-			next_loc_addr = pools_[dir].merge_move( 
-				data, size, loc_addr, off,
-				&pools_[next_dir], &header); 
+			if(1 == cnt)
+				next_loc_addr = pools_[dir].merge_copy( 
+					segs[0].data, size, loc_addr, off,
+					&pools_[next_dir], &header); 
+			else
+				next_loc_addr = pools_[dir].merge_copy( 
+					segs, cnt, loc_addr, &pools_[next_dir], &header);
 
 			if(-1 == next_loc_addr){
 				error(dir);
 				error(next_dir);
 				return -1;	
 			}
+			lat_stat_.migrated(dir, moved);
 			rt = addrEval.global_addr(next_dir, next_loc_addr);
+			
+			opt_lock_guard glk(gid_mutex_);
 			global_id_->Update(addr, rt);
-			global_id_->Commit(addr);
-			fprintf(acc_log_, "%-12s\t%08x\t%08x\t%08x\n", 
-				"insert", size, addr, off);
-			return addr;
+			*stale = internal_addr;
+			return rt;
 		}
 
 		// no migration
@@ -193,36 +658,41 @@ namespace BDB {
 		// it might be moved to another chunk of the same pool 
 		// due to size of data to be moved exceed size of 
 		// migration buffer that a pool contains
-		if(-1 == (loc_addr = 
-			pools_[dir].write(data, size, loc_addr, off, &header)) )
+		if(1 == cnt)
+			loc_addr = pools_[dir].write(segs[0].data, size, loc_addr, off, &header);
+		else
+			loc_addr = pools_[dir].appendv(segs, cnt, loc_addr, &header);
+		if((AddrType)-1 == loc_addr)
 		{
 			error(dir);
 			return -1;	
 		}
 		
 		rt = addrEval.global_addr(dir, loc_addr);
-		global_id_->Update(addr, rt);
-		if(!global_id_->Commit(addr)){
-			error(COMMIT_FAILURE, __LINE__);
-			return -1;
-		}
 		
-		fprintf(acc_log_, "%-12s\t%08x\t%08x\t%08x\n", 
-			"insert", size, addr, off);
-
-		return addr;
+		opt_lock_guard glk(gid_mutex_);
+		global_id_->Update(addr, rt);
+		// moved within the pool
+		*stale = (rt != internal_addr) ? internal_addr : -1;
+		return rt;
 	}
 	
 	/// TODO this method should called "replace"
 	AddrType
 	BDBImpl::update(char const *data, size_t size, AddrType addr)
 	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_UPDATE, addr, size);
+		PROFILE_SCOPE(PROF_OP);
 		// assert(0 != *this && "BDBImpl is not proper initiated");
 
+		reclaim();
+
+		opt_lock_guard alk(addr_mutex(addr));
+
 		AddrType internal_addr;
-		if( !global_id_->isAcquired(addr) )
+		if( (AddrType)-1 == (internal_addr = find(addr)) )
 			return -1;
-		internal_addr = global_id_->Find(addr);
 
 		unsigned int dir = addrEval.addr_to_dir(internal_addr);
 		AddrType loc_addr = addrEval.local_addr(internal_addr);
@@ -230,7 +700,6 @@ namespace BDB {
 		// check size
 		if( !addrEval.capacity_test(dir, size) ){
 			unsigned int old_dir = dir;
-			AddrType old_loc_addr = loc_addr;
 			AddrType new_internal_addr;
 
 			dir = addrEval.directory(size);
@@ -241,6 +710,7 @@ namespace BDB {
 			}
 
 			while(dir < addrEval.dir_count()){
+				opt_lock_guard plk(pools_[dir].mutex());
 				loc_addr = pools_[dir].write(data, size);
 				if(loc_addr != -1)	break;
 				dir++;
@@ -253,23 +723,25 @@ namespace BDB {
 
 			new_internal_addr = addrEval.global_addr(dir, loc_addr);
 			
+			opt_unique_lock glk(gid_mutex_);
 			global_id_->Update(addr, new_internal_addr);
 
 			if(!global_id_->Commit(addr)){
 				global_id_->Update(addr, internal_addr);
+				glk.unlock();
 				error(COMMIT_FAILURE, __LINE__);	
 				return -1;
 			}
+			glk.unlock();
 			
-			if(-1 == pools_[old_dir].free(old_loc_addr)){
-				error(old_dir);
-				return -1;
-			}
+			opt_lock_guard plk(pools_[old_dir].mutex());
+			retire(internal_addr);
 
-			fprintf(acc_log_, "%-12s\t%08x\t%08x\n", "update_put", size, addr);
+			done(ACC_UPDATE_PUT, STAT_UPDATE, dir, t0, size, addr);
 			return addr;
 		}
 		
+		opt_lock_guard plk(pools_[dir].mutex());
 		if(-1 == (loc_addr = 
 			pools_[dir].replace(data, size, loc_addr)) )
 		{
@@ -277,98 +749,363 @@ namespace BDB {
 			return -1;	
 		}
 
-		fprintf(acc_log_, "%-12s\t%08x\t%08x\n", "update", size, addr);
+		done(ACC_UPDATE, STAT_UPDATE, dir, t0, size, addr);
 		return addr;
 	}
 
 	size_t
 	BDBImpl::get(char *output, size_t size, AddrType addr, size_t off)
 	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_GET, addr, size);
+		PROFILE_SCOPE(PROF_OP);
 		// assert(0 != *this && "BDBImpl is not proper initiated");
 		
-		if( !global_id_->isAcquired(addr) )
+		epoch_manager::guard eg(epoch_);
+
+		AddrType internal_addr;
+		if( (AddrType)-1 == (internal_addr = find(addr)) )
+			return 0;
+
+		size_t rt(0);
+		unsigned int dir = addrEval.addr_to_dir(internal_addr);
+		AddrType loc_addr = addrEval.local_addr(internal_addr);
+		
+		if((size_t)-1 == (rt = pools_[dir].read_shared(output, size, loc_addr, off))){
+			error(dir);
+			return 0;
+		}
+		done(ACC_GET, STAT_GET, dir, t0, size, addr, off);
+		return rt;
+	}
+	
+	size_t
+	BDBImpl::getv(MutableSegment const* segs, size_t cnt, AddrType addr, 
+		size_t off)
+	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_GETV, addr, 0);
+		PROFILE_SCOPE(PROF_OP);
+		epoch_manager::guard eg(epoch_);
+
+		AddrType internal_addr;
+		if( (AddrType)-1 == (internal_addr = find(addr)) )
 			return 0;
-		AddrType internal_addr = global_id_->Find(addr);
 
 		size_t rt(0);
 		unsigned int dir = addrEval.addr_to_dir(internal_addr);
 		AddrType loc_addr = addrEval.local_addr(internal_addr);
 		
-		if(-1 == (rt = pools_[dir].read(output, size, loc_addr, off))){
+		if((size_t)-1 == (rt = pools_[dir].read_shared(segs, cnt, loc_addr, off))){
 			error(dir);
 			return 0;
 		}
-		fprintf(acc_log_, "%-12s\t%08x\t%08x\t%08x\n", "get", size, addr, off);
+		done(ACC_GETV, STAT_GET, dir, t0, rt, addr, off);
+		return rt;
+	}
+
+	View
+	BDBImpl::view(AddrType addr, size_t off, size_t size)
+	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_VIEW, addr, size);
+		PROFILE_SCOPE(PROF_OP);
+		View rt = { 0, 0, (AddrType)-1 };
+
+		ChunkHeader header;
+		AddrType internal_addr;
+		if((AddrType)-1 == (internal_addr = begin_reading(addr, &header)))
+			return rt;
+
+		if(off > header.size) off = header.size;
+		if(size > header.size - off) size = header.size - off;
+
+		unsigned int dir = addrEval.addr_to_dir(internal_addr);
+		AddrType loc_addr = addrEval.local_addr(internal_addr);
+		if(0 == size)
+			rt.data = "";
+		else if(0 == (rt.data = pools_[dir].map(loc_addr, off, size))){
+			error(SYSTEM_ERROR, __LINE__);
+			end_reading(internal_addr);
+			return rt;
+		}
+		rt.size = size;
+		rt.chunk = internal_addr;
+		done(ACC_VIEW, STAT_GET, dir, t0, size, addr, off);
+		return rt;
+	}
+
+	size_t
+	BDBImpl::send_to_fd(AddrType addr, int fd, size_t off, size_t size)
+	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_SEND, addr, size);
+		PROFILE_SCOPE(PROF_OP);
+		ChunkHeader header;
+		AddrType internal_addr;
+		if((AddrType)-1 == (internal_addr = begin_reading(addr, &header)))
+			return -1;
+
+		if(off > header.size) off = header.size;
+		if(size > header.size - off) size = header.size - off;
+
+		// pinned rather than guarded by an epoch since fd may block
+		unsigned int dir = addrEval.addr_to_dir(internal_addr);
+		size_t rt = size ? pools_[dir].send(fd, 
+			addrEval.local_addr(internal_addr), off, size) : 0;
+		end_reading(internal_addr);
+
+		if((size_t)-1 == rt){
+			error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+		done(ACC_SEND, STAT_GET, dir, t0, rt, addr, off);
+		return rt;
+	}
+
+	void
+	BDBImpl::release(View const& v)
+	{
+		if(0 == v.data) return;
+		if(v.size) unmap_range(v.data, v.size);
+		end_reading(v.chunk);
+	}
+
+	size_t
+	BDBImpl::get_batch(AddrType const* addrs, size_t cnt, 
+		char* const* buffers, size_t *sizes)
+	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_GET_BATCH, cnt ? addrs[0] : (AddrType)-1, 0);
+		PROFILE_SCOPE(PROF_OP);
+		epoch_manager::guard eg(epoch_);
+
+		// group by pool, ordered by position in pool file
+		typedef std::pair<AddrType, size_t> LocIdx;
+		std::vector<std::vector<LocIdx> > grp(addrEval.dir_count());
+		for(size_t i=0; i<cnt; ++i){
+			AddrType internal_addr;
+			if( (AddrType)-1 == (internal_addr = find(addrs[i])) ){
+				sizes[i] = 0;
+				continue;
+			}
+			grp[addrEval.addr_to_dir(internal_addr)].push_back(
+				LocIdx(addrEval.local_addr(internal_addr), i));
+		}
+
+		size_t rt(0);
+		std::vector<AddrType> locs;
+		std::vector<char*> bufs;
+		std::vector<size_t> szs;
+		for(unsigned int dir=0; dir<grp.size(); ++dir){
+			size_t n = grp[dir].size();
+			if(0 == n) continue;
+			std::sort(grp[dir].begin(), grp[dir].end());
+			locs.resize(n);
+			bufs.resize(n);
+			szs.resize(n);
+			for(size_t j=0; j<n; ++j){
+				locs[j] = grp[dir][j].first;
+				bufs[j] = buffers[grp[dir][j].second];
+				szs[j] = sizes[grp[dir][j].second];
+			}
+			bool failed = ((size_t)-1 == pools_[dir].read_shared(
+				&locs[0], n, &bufs[0], &szs[0]));
+			if(failed) error(dir);
+			else rt += n;
+			for(size_t j=0; j<n; ++j)
+				sizes[grp[dir][j].second] = failed ? 0 : szs[j];
+		}
+		done(ACC_GET_BATCH, STAT_GET, -1, t0, 
+			(unsigned int)cnt, (unsigned int)rt);
 		return rt;
 	}
 	
 	size_t
 	BDBImpl::get(std::string *output, size_t max, AddrType addr, size_t off)
 	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_STRING_GET, addr, max);
+		PROFILE_SCOPE(PROF_OP);
 		// assert(0 != *this && "BDBImpl is not proper initiated");
 		
-		if( !global_id_->isAcquired(addr) )
+		epoch_manager::guard eg(epoch_);
+
+		AddrType internal_addr;
+		if( (AddrType)-1 == (internal_addr = find(addr)) )
 			return 0;
-		AddrType internal_addr = global_id_->Find(addr);
 
 		size_t rt(0);
 		unsigned int dir = addrEval.addr_to_dir(internal_addr);
 		AddrType loc_addr = addrEval.local_addr(internal_addr);
 		
-		if( -1 == (rt = pools_[dir].read(output, max, loc_addr, off))){
+		if( (size_t)-1 == (rt = pools_[dir].read_shared(output, max, loc_addr, off))){
 			error(dir);
 			return 0;
 		}
-		fprintf(acc_log_, "%-12s\t%08x\t%08x\t%08x\n", "string_get", max, addr, off);
+		done(ACC_STRING_GET, STAT_GET, dir, t0, max, addr, off);
 		return rt;
 	}
 
 	size_t
 	BDBImpl::del(AddrType addr)
 	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_DEL, addr, 0);
+		PROFILE_SCOPE(PROF_OP);
 		// assert(0 != *this && "BDBImpl is not proper initiated");
 	
+		reclaim();
+
+		opt_lock_guard alk(addr_mutex(addr));
+
 		AddrType internal_addr;
 		
-		if( !global_id_->isAcquired(addr) )
+		if( (AddrType)-1 == (internal_addr = find(addr)) )
 			return -1;
-		internal_addr = global_id_->Find(addr);
 
 		unsigned int dir = addrEval.addr_to_dir(internal_addr);
-		AddrType loc_addr = addrEval.local_addr(internal_addr);
 		
-		if(-1 == pools_[dir].free(loc_addr)){
-			error(dir);
-			return -1;	
+		opt_unique_lock plk(pools_[dir].mutex());
+		opt_unique_lock glk(gid_mutex_);
+		if(-1 == global_id_->Release(addr)){ // locked by a stream
+			glk.unlock();
+			error(POOL_LOCKED, __LINE__);
+			return -1;
 		}
-		global_id_->Release(addr);
 		if( !global_id_->Commit(addr) ){
+			glk.unlock();
 			error(COMMIT_FAILURE, __LINE__);
 			return -1;
 		}
-		fprintf(acc_log_, "%-12s\t%08x\n", "del", addr);
+		glk.unlock();
+		retire(internal_addr);
+		plk.unlock();
+		done(ACC_DEL, STAT_DEL, dir, t0, addr);
 		return 0;
 	}
 
+	size_t
+	BDBImpl::del_batch(AddrType const* addrs, size_t cnt)
+	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_DEL_BATCH, cnt ? addrs[0] : (AddrType)-1, 0);
+		PROFILE_SCOPE(PROF_OP);
+		reclaim();
+
+		std::vector<char> need(ADDR_LOCK_CNT, 0);
+		for(size_t i=0; i<cnt; ++i)
+			need[addrs[i] % ADDR_LOCK_CNT] = 1;
+		stripe_lock alk(addr_mutex_, need);
+
+		std::vector<AddrType> ids, internals;
+		opt_unique_lock glk(gid_mutex_);
+		for(size_t i=0; i<cnt; ++i){
+			AddrType internal_addr;
+			if( (AddrType)-1 == (internal_addr = find(addrs[i])) )
+				continue;
+			if(-1 == global_id_->Release(addrs[i])){ // locked by a stream
+				error(POOL_LOCKED, __LINE__);
+				continue;
+			}
+			ids.push_back(addrs[i]);
+			internals.push_back(internal_addr);
+		}
+		// consecutive IDs are committed as ranges
+		std::sort(ids.begin(), ids.end());
+		if(!ids.empty() && !global_id_->Commit(&ids[0], ids.size())){
+			glk.unlock();
+			error(COMMIT_FAILURE, __LINE__);
+			return 0;
+		}
+		glk.unlock();
+		
+		retire(internals);
+		done(ACC_DEL_BATCH, STAT_DEL, -1, t0, 
+			(unsigned int)cnt, (unsigned int)ids.size());
+		return ids.size();
+	}
+
+	size_t
+	BDBImpl::del_range(AddrType first, AddrType last)
+	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_DEL_RANGE, first, 0);
+		PROFILE_SCOPE(PROF_OP);
+		reclaim();
+
+		// no ID beyond max_used() is in use
+		{
+			opt_lock_guard glk(gid_mutex_);
+			if(first < global_id_->begin()) first = global_id_->begin();
+			AddrType used_end = global_id_->begin() + global_id_->max_used();
+			if(last > used_end) last = used_end;
+		}
+		if(first >= last) return 0;
+
+		// scan by the lock-free find, then check again under locks
+		std::vector<AddrType> ids;
+		std::vector<char> need(ADDR_LOCK_CNT, 0);
+		for(AddrType a = first; a != last; ++a){
+			if((AddrType)-1 == find(a)) continue;
+			ids.push_back(a);
+			need[a % ADDR_LOCK_CNT] = 1;
+		}
+		if(ids.empty()) return 0;
+		stripe_lock alk(addr_mutex_, need);
+
+		std::vector<AddrType> internals;
+		size_t released(0);
+		opt_unique_lock glk(gid_mutex_);
+		for(size_t i=0; i<ids.size(); ++i){
+			AddrType internal_addr;
+			if( (AddrType)-1 == (internal_addr = find(ids[i])) )
+				continue;
+			if(-1 == global_id_->Release(ids[i])){ // locked by a stream
+				error(POOL_LOCKED, __LINE__);
+				continue;
+			}
+			ids[released++] = ids[i];
+			internals.push_back(internal_addr);
+		}
+		ids.resize(released);
+		// consecutive IDs are committed as ranges
+		if(!ids.empty() && !global_id_->Commit(&ids[0], ids.size())){
+			glk.unlock();
+			error(COMMIT_FAILURE, __LINE__);
+			return 0;
+		}
+		glk.unlock();
+		
+		retire(internals);
+		done(ACC_DEL_RANGE, STAT_DEL, -1, t0, 
+			first, last, (unsigned int)internals.size());
+		return internals.size();
+	}
+
 	size_t
 	BDBImpl::del(AddrType addr, size_t off, size_t size)
 	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_PARTIAL_DEL, addr, size);
+		PROFILE_SCOPE(PROF_OP);
 		// assert(0 != *this && "BDBImpl is not proper initiated");
 		
+		opt_lock_guard alk(addr_mutex(addr));
 	
-		if( !global_id_->isAcquired(addr) )
+		if( (AddrType)-1 == (addr = find(addr)) )
 			return -1;
-		addr = global_id_->Find(addr);
 	
 
 		unsigned int dir = addrEval.addr_to_dir(addr);
 		AddrType loc_addr = addrEval.local_addr(addr);
 		size_t nsize;
+		opt_lock_guard plk(pools_[dir].mutex());
 		if(-1 == (nsize = pools_[dir].erase(loc_addr, off, size))){
 			error(dir);
 			return -1;
 		}
-		fprintf(acc_log_, "%-12s\t%08x\t%08x\t%08x\n", "partial_del", addr, off, size);
+		done(ACC_PARTIAL_DEL, STAT_DEL, dir, t0, addr, off, size);
 		return nsize;
 	}
 	
@@ -379,16 +1116,24 @@ namespace BDB {
 	stream_state const*
 	BDBImpl::ostream(size_t stream_size)
 	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_OSTREAM, -1, stream_size);
+		PROFILE_SCOPE(PROF_OP);
 		// assert(0 != *this && "BDBImpl is not proper initiated");
 		
-		if(!global_id_->avail()){
+		if(full()){
 			error(ADDRESS_OVERFLOW, __LINE__);
 			return 0;
 		}
 		
-		unsigned int dir = addrEval.directory(stream_size);
+		// streams of unknown size start from the smallest pool
+		bool growable = (npos == stream_size);
+		unsigned int dir = growable ? 0 : addrEval.directory(stream_size);
+		if(growable)
+			stream_size = addrEval.chunk_size_estimation(dir);
 		AddrType inter_addr(0), loc_addr(0);
 		while(dir < addrEval.dir_count()){
+			opt_lock_guard plk(pools_[dir].mutex());
 			loc_addr = pools_[dir].write((char const*)0, stream_size);
 			if(loc_addr != -1)	break;
 			dir++;
@@ -401,18 +1146,24 @@ namespace BDB {
 
 		inter_addr = addrEval.global_addr(dir, loc_addr);
 
-		fprintf(acc_log_, "%-12s\t%08x\n", "ostream", stream_size);
+		done(ACC_OSTREAM, STAT_STREAM, dir, t0, stream_size);
 		
+		opt_unique_lock slk(stream_mutex_);
 		stream_state *rt = stream_state_pool_.malloc();
+		slk.unlock();
 		if(0 == rt) return 0;
 
 		rt->read_write = stream_state::WRT;
 		rt->existed = false;
 		rt->error = false;
+		rt->growable = growable;
 		rt->inter_dest_addr = inter_addr;
 		rt->offset = 0;
 		rt->size = stream_size;
 		rt->used = 0;
+		rt->wbuf = 0;
+		rt->wbuf_cap = stream_buf_size_;
+		rt->wbuf_used = 0;
 
 		return rt;
 	}
@@ -421,23 +1172,40 @@ namespace BDB {
 	stream_state const*
 	BDBImpl::ostream(size_t stream_size, AddrType addr, size_t off)
 	{
+		boost::uint64_t t0 = access_log::now();
+		TRACE_OP_SCOPE(ACC_OSTREAM_INS, addr, stream_size);
+		PROFILE_SCOPE(PROF_OP);
 		// assert(0 != *this && "BDBImpl is not proper initiated");
 
-		// TODO: support better error diagnose
-		if( !global_id_->isAcquired(addr) ||  global_id_->isLocked(addr) )
+		// only new streams grow
+		if(npos == stream_size){
+			error(DATA_TOO_BIG, __LINE__);
 			return 0;
-		
-		global_id_->Lock(addr);
+		}
+
+		opt_lock_guard alk(addr_mutex(addr));
 
 		AddrType internal_addr;
-		internal_addr = global_id_->Find(addr);
+		{
+			opt_lock_guard glk(gid_mutex_);
+			PROFILE_SCOPE(PROF_ADDR);
+			// TODO: support better error diagnose
+			if( !global_id_->isAcquired(addr) ||  global_id_->isLocked(addr) )
+				return 0;
+			
+			global_id_->Lock(addr);
+			internal_addr = global_id_->Find(addr);
+		}
 
 		unsigned int dir = addrEval.addr_to_dir(internal_addr);
 		AddrType loc_addr = addrEval.local_addr(internal_addr);
 		
+		opt_unique_lock plk(pools_[dir].mutex());
+
 		ChunkHeader header;
 		if(-1 == pools_[dir].head(&header, loc_addr)){
 			error(dir);
+			opt_lock_guard glk(gid_mutex_);
 			global_id_->Unlock(addr);
 			return 0;
 		}
@@ -447,12 +1215,18 @@ namespace BDB {
 
 		if(-1 == next_dir){
 			error(DATA_TOO_BIG, __LINE__);
+			opt_lock_guard glk(gid_mutex_);
 			global_id_->Unlock(addr);
 			return 0;
 		}
 		
 		off = (npos == off) ? header.size : off;
 		
+		opt_unique_lock nlk(pools_[next_dir].mutex(), boost::defer_lock);
+		lock_also(plk, dir, nlk, next_dir);
+
+		size_t moved = header.size;
+
 		// TODO: append optimization (no copy)
 		AddrType next_loc_addr =
 			pools_[dir].merge_copy( 
@@ -461,18 +1235,24 @@ namespace BDB {
 		
 		if(-1 == next_loc_addr){
 			error(next_dir);
+			opt_lock_guard glk(gid_mutex_);
 			global_id_->Unlock(addr);
 			return 0;
 		}
+		if(next_dir != dir)
+			lat_stat_.migrated(dir, moved);
 		
-		fprintf(acc_log_, "%-12s\t%08x\t%08x\t%08x\n", 
-			"ostream_ins", stream_size, addr, off);
+		done(ACC_OSTREAM_INS, STAT_STREAM, next_dir, t0, 
+			stream_size, addr, off);
 
+		opt_unique_lock slk(stream_mutex_);
 		stream_state *rt = stream_state_pool_.malloc();
+		slk.unlock();
 		if(0 == rt) return 0;
 		rt->read_write = stream_state::WRT;
 		rt->existed = true;
 		rt->error = false;
+		rt->growable = false;
 		rt->ext_addr = addr;
 		rt->inter_src_addr = internal_addr;
 		rt->inter_dest_addr = addrEval.global_addr(
@@ -480,6 +1260,9 @@ namespace BDB {
 		rt->offset = off;
 		rt->size = stream_size;
 		rt->used = 0;
+		rt->wbuf = 0;
+		rt->wbuf_cap = stream_buf_size_;
+		rt->wbuf_used = 0;
 
 		return rt;
 	}
@@ -487,11 +1270,34 @@ namespace BDB {
 	stream_state const*
 	BDBImpl::istream(size_t stream_size, AddrType addr, size_t off)
 	{
-		/// TODO Consider allow reader when a chunk is been written
-		if(!global_id_->isAcquired(addr) || global_id_->isLocked(addr))
-			return 0;
+		boost::uint64_t t0 = access_log::now();
+		opt_lock_guard alk(addr_mutex(addr));
 
-		AddrType inter_addr = global_id_->Find(addr); 
+		AddrType inter_addr;
+		{
+			opt_lock_guard glk(gid_mutex_);
+			PROFILE_SCOPE(PROF_ADDR);
+			/// TODO Consider allow reader when a chunk is been written
+			if(!global_id_->isAcquired(addr) || global_id_->isLocked(addr))
+				return 0;
+
+			inter_addr = global_id_->Find(addr); 
+		}
+
+		// header is read again only if the pool is modified in place
+		unsigned int dir = addrEval.addr_to_dir(inter_addr);
+		ChunkHeader header;
+		unsigned int seq;
+		{
+			opt_lock_guard plk(pools_[dir].mutex());
+			seq = pools_[dir].modify_seq();
+			if(-1 == pools_[dir].head(&header, addrEval.local_addr(inter_addr))){
+				error(dir);
+				return 0;
+			}
+		}
+
+		opt_lock_guard slk(stream_mutex_);
 
 		// register to in_reading hash table
 		AddrCntCont::iterator iter;
@@ -506,12 +1312,21 @@ namespace BDB {
 		rt->read_write = stream_state::READ;
 		rt->existed = true;
 		rt->error = false;
+		rt->growable = false;
 		rt->ext_addr = addr;
 		rt->inter_src_addr = inter_addr;
 		rt->offset = off;
 		rt->size = stream_size;
 		rt->used = 0;
-
+		rt->wbuf = 0;
+		rt->wbuf_cap = 0;
+		rt->wbuf_used = 0;
+		rt->data_size = header.size;
+		rt->data_seq = seq;
+		rt->ra_end = off;
+		rt->ra_win = 0;
+
+		lat_stat_.record(STAT_STREAM, dir, access_log::now() - t0);
 		return rt;
 	}
 
@@ -519,14 +1334,39 @@ namespace BDB {
 	BDBImpl::stream_write(stream_state const* state, char const* data, size_t size)
 	{
 		stream_state *ss = const_cast<stream_state*>(state);
-		if(ss->size - ss->used < size){
-			ss->error = true;
+		if(-1 == stream_reserve(ss, size))
 			return ss;
+
+		// small writes are combined in the stream buffer
+		if(size < ss->wbuf_cap){
+			if(ss->wbuf_used + size > ss->wbuf_cap && -1 == stream_flush(ss))
+				return ss;
+			if(0 == ss->wbuf)
+				ss->wbuf = new (std::nothrow) char[ss->wbuf_cap];
+			if(ss->wbuf){
+				memcpy(ss->wbuf + ss->wbuf_used, data, size);
+				ss->wbuf_used += size;
+				ss->used += size;
+				
+				// flush once the buffer reaches an aligned boundary
+				size_t beg = ss->offset + ss->used - ss->wbuf_used;
+				size_t mark = ss->wbuf_cap;
+				if(mark > STREAM_ALIGN)
+					mark -= (beg + mark) % STREAM_ALIGN;
+				if(ss->wbuf_used >= mark)
+					stream_flush(ss);
+				return ss;
+			}
 		}
+		
+		// large writes go directly after pending data
+		if(-1 == stream_flush(ss))
+			return ss;
 
 		unsigned int dir = addrEval.addr_to_dir(ss->inter_dest_addr);
 		AddrType loc_addr = addrEval.local_addr(ss->inter_dest_addr);
 
+		opt_lock_guard plk(pools_[dir].mutex());
 		if(size != pools_[dir].overwrite(
 			data, size, loc_addr, ss->offset + ss->used) )
 		{
@@ -551,9 +1391,39 @@ namespace BDB {
 
 		size_t toRead = (ss->size - ss->used < size) ?
 			ss->size - ss->used : size;
+
+		// update or append may have resized the chunk in place
+		if(ss->data_seq != pools_[dir].modify_seq()){
+			ChunkHeader fresh;
+			opt_lock_guard plk(pools_[dir].mutex());
+			ss->data_seq = pools_[dir].modify_seq();
+			if(-1 == pools_[dir].head(&fresh, loc_addr)){
+				error(dir);
+				ss->error = true;
+				return ss;
+			}
+			ss->data_size = fresh.size;
+		}
 		
-		if(toRead != pools_[dir].read(output, size, loc_addr,
-			ss->offset + ss->used))
+		// keep read-ahead half a window in front of the reader
+		size_t pos = ss->offset + ss->used;
+		size_t end = ss->offset + ss->size;
+		if(end > ss->data_size) end = ss->data_size;
+		if(ss->ra_end < end && pos + toRead + ss->ra_win/2 >= ss->ra_end){
+			size_t beg = (ss->ra_end > pos) ? ss->ra_end : pos;
+			ss->ra_win = (0 == ss->ra_win) ? READAHEAD_MIN :
+				(ss->ra_win < READAHEAD_MAX/2) ? ss->ra_win*2 : READAHEAD_MAX;
+			size_t len = (end - beg < ss->ra_win) ? end - beg : ss->ra_win;
+			pools_[dir].will_need(loc_addr, beg, len);
+			ss->ra_end = beg + len;
+		}
+
+		ChunkHeader header;
+		header.size = ss->data_size;
+
+		// the chunk is kept by in_reading_
+		if(toRead != pools_[dir].read_shared(output, size, loc_addr,
+			ss->offset + ss->used, &header))
 		{
 			error(dir);
 			ss->error = true;
@@ -563,9 +1433,146 @@ namespace BDB {
 
 	}
 
+	stream_state const*
+	BDBImpl::stream_write_from_fd(stream_state const* state, int fd, size_t size)
+	{
+		stream_state *ss = const_cast<stream_state*>(state);
+		if(-1 == stream_reserve(ss, size) || -1 == stream_flush(ss))
+			return ss;
+
+		unsigned int dir = addrEval.addr_to_dir(ss->inter_dest_addr);
+		AddrType loc_addr = addrEval.local_addr(ss->inter_dest_addr);
+
+		opt_lock_guard plk(pools_[dir].mutex());
+		size_t got = pools_[dir].receive(fd, size, loc_addr, ss->offset + ss->used);
+		if(size != got){
+			if((size_t)-1 == got)
+				error(dir);
+			ss->error = true;
+			return ss;
+		}
+		
+		ss->used += size;
+		
+		return ss;
+	}
+
+	AddrType
+	BDBImpl::put_from_fd(int fd, size_t size)
+	{
+		stream_state const* os = ostream(size);
+		if(0 == os) return -1;
+		return stream_finish(stream_write_from_fd(os, fd, size));
+	}
+
+	int
+	BDBImpl::stream_reserve(stream_state *ss, size_t size)
+	{
+		if(ss->size - ss->used >= size) return 0;
+		if(!ss->growable){
+			ss->error = true;
+			return -1;
+		}
+		return stream_grow(ss, ss->used + size);
+	}
+
+	int
+	BDBImpl::stream_grow(stream_state *ss, size_t need)
+	{
+		unsigned int dir = addrEval.addr_to_dir(ss->inter_dest_addr);
+		AddrType loc_addr = addrEval.local_addr(ss->inter_dest_addr);
+
+		// at least double the room to keep copying linear; near the
+		// largest pool, settle for one that fits
+		size_t want = std::max(need, (size_t)2 * ss->size);
+		unsigned int next_dir = dir + 1;
+		while(next_dir < addrEval.dir_count() && 
+			addrEval.chunk_size_estimation(next_dir) < want)
+			++next_dir;
+		if(next_dir >= addrEval.dir_count()){
+			next_dir = dir + 1;
+			while(next_dir < addrEval.dir_count() && 
+				addrEval.chunk_size_estimation(next_dir) < need)
+				++next_dir;
+		}
+		if(next_dir >= addrEval.dir_count()){
+			error(DATA_TOO_BIG, __LINE__);
+			ss->error = true;
+			return -1;
+		}
+		size_t room = addrEval.chunk_size_estimation(next_dir);
+
+		// only written data are copied, pending ones stay in wbuf
+		ChunkHeader header;
+		header.size = ss->used - ss->wbuf_used;
+
+		opt_unique_lock plk(pools_[dir].mutex());
+		opt_unique_lock nlk(pools_[next_dir].mutex(), boost::defer_lock);
+		lock_also(plk, dir, nlk, next_dir);
+
+		AddrType next_loc_addr = pools_[dir].merge_copy(
+			0, room - header.size, loc_addr, header.size, 
+			&pools_[next_dir], &header);
+		if(-1 == next_loc_addr){
+			error(dir);
+			error(next_dir);
+			ss->error = true;
+			return -1;
+		}
+		
+		lat_stat_.migrated(dir, ss->used - ss->wbuf_used);
+
+		// the old chunk has never been published
+		if(-1 == pools_[dir].free(loc_addr))
+			error(dir);
+
+		ss->inter_dest_addr = addrEval.global_addr(next_dir, next_loc_addr);
+		ss->size = room;
+		return 0;
+	}
+
+	int
+	BDBImpl::stream_flush(stream_state *ss)
+	{
+		if(0 == ss->wbuf_used) return 0;
+
+		unsigned int dir = addrEval.addr_to_dir(ss->inter_dest_addr);
+		AddrType loc_addr = addrEval.local_addr(ss->inter_dest_addr);
+		size_t pending = ss->wbuf_used;
+		ss->wbuf_used = 0;
+
+		opt_lock_guard plk(pools_[dir].mutex());
+		if(pending != pools_[dir].overwrite(
+			ss->wbuf, pending, loc_addr, ss->offset + ss->used - pending) )
+		{
+			error(dir);
+			ss->error = true;
+			return -1;
+		}
+		return 0;
+	}
+
+	stream_state const*
+	BDBImpl::stream_buffer(stream_state const* state, size_t size)
+	{
+		stream_state *ss = const_cast<stream_state*>(state);
+		if(stream_state::WRT != ss->read_write || -1 == stream_flush(ss))
+			return ss;
+		if(size != ss->wbuf_cap){
+			delete [] ss->wbuf;
+			ss->wbuf = 0;
+			ss->wbuf_cap = size;
+		}
+		return ss;
+	}
+
 	AddrType
 	BDBImpl::stream_finish(stream_state const* state)
 	{
+		boost::uint64_t t0 = access_log::now();
+		if(stream_state::WRT == state->read_write)
+			stream_flush(const_cast<stream_state*>(state));
+
 		if(state->error){
 			stream_abort(state);
 			return -1;
@@ -576,69 +1583,76 @@ namespace BDB {
 		
 		unsigned int dir = 
 			addrEval.addr_to_dir(ss->inter_src_addr);
-		AddrType loc_addr = 
-			addrEval.local_addr(ss->inter_src_addr);
 
 		// read mode
 		if(stream_state::READ == ss->read_write){
-			// unpine if the inter_dest addr is pinned 
-			// and a reader is the last one
-			AddrCntCont::iterator iter = 
-				in_reading_.find(ss->inter_src_addr);
-
-			assert(in_reading_.end() != iter && 
-				"unexpected address");
-
-			iter->second--;
-			if(iter->second == 0){ // the last reader
-				if(pools_[dir].is_pinned(loc_addr)){
-					pools_[dir].unpine(loc_addr);
-					pools_[dir].free(loc_addr);
-				}
-				in_reading_.erase(iter);
-			}
-			
+			end_reading(ss->inter_src_addr);
+			opt_unique_lock slk(stream_mutex_);
 			rt = ss->ext_addr;
 			stream_state_pool_.free(ss);
+			slk.unlock();
+			lat_stat_.record(STAT_STREAM, dir, access_log::now() - t0);
 			return rt;
 		}
 		
 		// write mode
+		if(ss->growable && ss->used < ss->size){
+			// give back the room not written
+			unsigned int dest_dir = addrEval.addr_to_dir(ss->inter_dest_addr);
+			opt_lock_guard plk(pools_[dest_dir].mutex());
+			if((size_t)-1 == pools_[dest_dir].erase(
+				addrEval.local_addr(ss->inter_dest_addr), ss->used, npos))
+			{
+				error(dest_dir);
+				ss->error = true;
+			}else
+				ss->size = ss->used;
+		}
 		if(ss->used == ss->size){
 			if(ss->existed){
-				
-				// if anyone is reading the chunk
-				// do pine instead of free
-				AddrCntCont::iterator iter = 
-					in_reading_.find(ss->inter_src_addr);
-				if(in_reading_.end() != iter)
-					pools_[dir].pine(loc_addr);
-				else
-					pools_[dir].free(loc_addr);
+				reclaim();
 
+				opt_lock_guard alk(addr_mutex(ss->ext_addr));
+				opt_lock_guard plk(pools_[dir].mutex());
+				
+				opt_unique_lock glk(gid_mutex_);
 				global_id_->Update(ss->ext_addr, ss->inter_dest_addr);
 				
 				if(!global_id_->Commit(ss->ext_addr)){
 					global_id_->Update(ss->ext_addr, ss->inter_src_addr);
+					glk.unlock();
 					error(COMMIT_FAILURE, __LINE__);	
 					return -1;
 				}
+				global_id_->Unlock(ss->ext_addr);
+				glk.unlock();
+
+				// pined instead of freed if anyone is reading the chunk
+				retire(ss->inter_src_addr);
 			}else {
+				opt_unique_lock glk(gid_mutex_);
 				if(-1 == (ss->ext_addr = 
 					global_id_->Acquire(ss->inter_dest_addr)))
 				{
+					glk.unlock();
 					error(SYSTEM_ERROR, __LINE__);
 					stream_abort(state);
 					return -1;
 				}	
 				if(!global_id_->Commit(ss->ext_addr)){
 					global_id_->Release(ss->ext_addr);
+					glk.unlock();
 					error(COMMIT_FAILURE, __LINE__);
 					return -1;
 				}
 			}	
 			rt = ss->ext_addr;
+			unsigned int dest_dir = addrEval.addr_to_dir(ss->inter_dest_addr);
+			delete [] ss->wbuf;
+			opt_unique_lock slk(stream_mutex_);
 			stream_state_pool_.free(ss);
+			slk.unlock();
+			lat_stat_.record(STAT_STREAM, dest_dir, access_log::now() - t0);
 		}else { //incomplete buffer
 			stream_abort(state);
 			rt = -1;
@@ -649,34 +1663,54 @@ namespace BDB {
 	size_t
 	BDBImpl::stream_pause(stream_state const* state)
 	{
-		size_t rt = reinterpret_cast<size_t>(state);
-		rt ^= 0xDEA3;
-
-		assert(enc_stream_state_.end() == enc_stream_state_.find(rt));
-
-		enc_stream_state_.insert(rt);
+		// nothing is left in memory while the stream is paused
+		if(stream_state::WRT == state->read_write){
+			stream_state *ss = const_cast<stream_state*>(state);
+			stream_flush(ss);
+			delete [] ss->wbuf;
+			ss->wbuf = 0;
+		}
 
+		opt_lock_guard slk(stream_mutex_);
+		size_t rt = next_handle_++;
+		enc_stream_state_[rt] = const_cast<stream_state*>(state);
+
+		// output streams survive restarts
+		if(stream_log_ && stream_state::WRT == state->read_write && !state->error){
+			fprintf(stream_log_, "+%lx\t%x\t%x\t%x\t%x\t%x\t%x\t%x\t%x\n", 
+				(unsigned long)rt, 
+				(state->existed ? 1u : 0u) | (state->growable ? 2u : 0u),
+				state->existed ? state->ext_addr : 0, 
+				state->existed ? state->inter_src_addr : 0,
+				state->inter_dest_addr, state->offset, state->size, 
+				state->used, state->wbuf_cap);
+			fflush(stream_log_);
+		}
 		return rt;
 	}
 	
 	stream_state const*
 	BDBImpl::stream_resume(size_t encrypt_handle)
 	{
-		if(enc_stream_state_.end() == enc_stream_state_.find(encrypt_handle) )
+		opt_lock_guard slk(stream_mutex_);
+		EncStreamCont::iterator iter = enc_stream_state_.find(encrypt_handle);
+		if(enc_stream_state_.end() == iter)
 			return 0;
-		enc_stream_state_.erase(encrypt_handle);
-		encrypt_handle ^= 0xDEA3;
-		return reinterpret_cast<stream_state const*>(encrypt_handle);
+		stream_state *rt = iter->second;
+		enc_stream_state_.erase(iter);
+		if(stream_log_ && stream_state::WRT == rt->read_write){
+			fprintf(stream_log_, "-%lx\n", (unsigned long)encrypt_handle);
+			fflush(stream_log_);
+		}
+		return rt;
 	}
 
 	void
 	BDBImpl::stream_expire(size_t encrypt_handle)
 	{
-		assert(enc_stream_state_.end() == 
-			enc_stream_state_.find(encrypt_handle) );
-
+		// resume takes the handle out of enc_stream_state_ atomically
 		stream_state const* state = stream_resume(encrypt_handle);
-		enc_stream_state_.erase(encrypt_handle);
+		if(0 == state) return;
 		stream_abort(state);
 	}
 
@@ -686,29 +1720,8 @@ namespace BDB {
 		stream_state *ss = const_cast<stream_state*>(state);
 		
 		if(stream_state::READ == ss->read_write){
-			unsigned int dir = 
-				addrEval.addr_to_dir(ss->inter_src_addr);
-			AddrType loc_addr = 
-				addrEval.local_addr(ss->inter_src_addr);
-			
-			// unpine if the inter_dest addr is pinned 
-			// and a reader is the last one
-			AddrCntCont::iterator iter = 
-				in_reading_.find(ss->inter_src_addr);
-
-			assert(in_reading_.end() != iter && 
-				"unexpected address");
-
-			iter->second--;
-			
-			if(iter->second == 0){ // the last reader
-				if(pools_[dir].is_pinned(loc_addr)){
-					pools_[dir].unpine(loc_addr);
-					pools_[dir].free(loc_addr);
-				}
-				in_reading_.erase(iter);
-			}
-
+			end_reading(ss->inter_src_addr);
+			opt_lock_guard slk(stream_mutex_);
 			stream_state_pool_.free(ss);
 			return;
 		}
@@ -716,18 +1729,133 @@ namespace BDB {
 		unsigned int dir = addrEval.addr_to_dir(ss->inter_dest_addr);
 		AddrType loc_addr = addrEval.local_addr(ss->inter_dest_addr);
 		
+		opt_unique_lock plk(pools_[dir].mutex());
 		if(-1 == pools_[dir].free(loc_addr))
 			error(dir);
+		plk.unlock();
 		
-		if(ss->existed) global_id_->Unlock(ss->ext_addr);
+		delete [] ss->wbuf;
+		opt_lock_guard slk(stream_mutex_);
+		if(ss->existed){
+			opt_lock_guard glk(gid_mutex_);
+			global_id_->Unlock(ss->ext_addr);
+		}
 
 		stream_state_pool_.free(ss);
 	}
 
+	void
+	BDBImpl::init_streams(char const* fname)
+	{
+		typedef std::map<size_t, stream_state> PausedCont;
+		PausedCont paused;
+
+		// replay the journal
+		if(FILE *fp = fopen(fname, "rb")){
+			char line[128];
+			while(fgets(line, sizeof(line), fp)){
+				unsigned long h;
+				unsigned int flags;
+				stream_state ss;
+				if('n' == line[0] && 1 == sscanf(line + 1, "%lx", &h)){
+					if(h > next_handle_) next_handle_ = h;
+				}else if('+' == line[0] && 9 == sscanf(line + 1, 
+					"%lx\t%x\t%x\t%x\t%x\t%x\t%x\t%x\t%x", &h, &flags,
+					&ss.ext_addr, &ss.inter_src_addr, &ss.inter_dest_addr,
+					&ss.offset, &ss.size, &ss.used, &ss.wbuf_cap))
+				{
+					ss.existed = (flags & 1);
+					ss.growable = (flags & 2);
+					paused[h] = ss;
+					if(h >= next_handle_) next_handle_ = h + 1;
+				}else if('-' == line[0] && 1 == sscanf(line + 1, "%lx", &h)){
+					paused.erase(h);
+				}
+			}
+			fclose(fp);
+		}
+
+		// restore streams whose chunks are intact
+		for(PausedCont::iterator i = paused.begin(); i != paused.end(); ++i){
+			stream_state &ss = i->second;
+			unsigned int dir = addrEval.addr_to_dir(ss.inter_dest_addr);
+			if(dir >= addrEval.dir_count() || ss.used > ss.size ||
+				!pools_[dir].is_used(addrEval.local_addr(ss.inter_dest_addr)))
+				continue;
+			if(ss.existed){
+				// the address must not have changed since the pause
+				if(!global_id_->isAcquired(ss.ext_addr) || 
+					global_id_->isLocked(ss.ext_addr) ||
+					ss.inter_src_addr != global_id_->Find(ss.ext_addr))
+					continue;
+				global_id_->Lock(ss.ext_addr);
+			}
+			stream_state *rt = stream_state_pool_.malloc();
+			if(0 == rt) break;
+			*rt = ss;
+			rt->read_write = stream_state::WRT;
+			rt->error = false;
+			rt->wbuf = 0;
+			rt->wbuf_used = 0;
+			enc_stream_state_[i->first] = rt;
+		}
+
+		// compact the journal to restored streams
+		std::string tmp = std::string(fname) + ".tmp";
+		FILE *fp = fopen(tmp.c_str(), "wb");
+		if(0 == fp)
+			throw std::runtime_error("create stream journal failed\n");
+		fprintf(fp, "n%lx\n", (unsigned long)next_handle_);
+		for(EncStreamCont::iterator i = enc_stream_state_.begin(); 
+			i != enc_stream_state_.end(); ++i)
+		{
+			stream_state const* ss = i->second;
+			fprintf(fp, "+%lx\t%x\t%x\t%x\t%x\t%x\t%x\t%x\t%x\n", 
+				(unsigned long)i->first, 
+				(ss->existed ? 1u : 0u) | (ss->growable ? 2u : 0u),
+				ss->ext_addr, ss->inter_src_addr, ss->inter_dest_addr, 
+				ss->offset, ss->size, ss->used, ss->wbuf_cap);
+		}
+		if(0 != fclose(fp) || 0 != rename(tmp.c_str(), fname))
+			throw std::runtime_error("write stream journal failed\n");
+
+		if(0 == (stream_log_ = fopen(fname, "ab")))
+			throw std::runtime_error("open stream journal failed\n");
+	}
+
+	void
+	BDBImpl::reclaim_orphans()
+	{
+		std::vector<AddrType> used;
+		for(AddrType i=0; i < global_id_->max_used(); ++i){
+			AddrType addr = global_id_->begin() + i;
+			if(global_id_->isAcquired(addr))
+				used.push_back(global_id_->Find(addr));
+		}
+		for(EncStreamCont::iterator i = enc_stream_state_.begin(); 
+			i != enc_stream_state_.end(); ++i)
+			used.push_back(i->second->inter_dest_addr);
+		std::sort(used.begin(), used.end());
+
+		std::vector<AddrType> orphans;
+		for(unsigned int dir=0; dir < addrEval.dir_count(); ++dir){
+			orphans.clear();
+			for(AddrType loc_addr=0; loc_addr < pools_[dir].max_used(); ++loc_addr){
+				if(pools_[dir].is_used(loc_addr) && !std::binary_search(
+					used.begin(), used.end(), addrEval.global_addr(dir, loc_addr)))
+					orphans.push_back(loc_addr);
+			}
+			if(orphans.empty()) continue;
+			if((size_t)-1 == pools_[dir].free(&orphans[0], orphans.size()))
+				error(dir);
+		}
+	}
+
 	AddrIterator
 	BDBImpl::begin() const
 	{
 		// assert(0 != *this && "BDBImpl is not proper initiated");
+		opt_lock_guard glk(gid_mutex_);
 		AddrType first_used = global_id_->begin();
 		first_used = global_id_->next_used(first_used);
 		
@@ -748,27 +1876,54 @@ namespace BDB {
 		bdbStater bstat(s);
 		bstat(this);
 	}
+
+	void
+	BDBImpl::metrics(std::string *out) const
+	{
+		Stat s;
+		stat(&s);
+		render_prometheus(s, out);
+	}
+
+	void
+	BDBImpl::write_metrics()
+	{
+		try{
+			while(1){
+				boost::this_thread::sleep(
+					boost::posix_time::seconds(metrics_interval_));
+				Stat s;
+				stat(&s);
+				if(!write_prometheus(s, metrics_file_.c_str()))
+					error(SYSTEM_ERROR, __LINE__);
+			}
+		}catch(boost::thread_interrupted const&){}
+	}
 	
 	bool
 	BDBImpl::full() const
-	{ return !global_id_->avail(); }
+	{ 
+		opt_lock_guard glk(gid_mutex_);
+		return !global_id_->avail(); 
+	}
 
 	void
 	BDBImpl::error(int errcode, int line)
 	{
 		// assert(0 != *this && "BDBImpl is not proper initiated");
 
+		if(errcode > 0 && errcode < Stat::ERROR_SLOTS)
+			err_cnt_[errcode].fetch_add(1, boost::memory_order_relaxed);
+
 		if(0 == err_log_) return;
 		
-		//lock
+		opt_lock_guard lk(log_mutex_);
 		
 		if(0 == ftello(err_log_)){ // write column names
 			fprintf(err_log_, "Pool ID\tLine\tMessage\n");
 		}
 		
-		fprintf(acc_log_, "None    \t%d\t%s\n", line, error_num_to_str()(errcode));
-		
-		//unlock
+		fprintf(err_log_, "None    \t%d\t%s\n", line, error_num_to_str()(errcode));
 	}
 
 	void
@@ -776,25 +1931,26 @@ namespace BDB {
 	{	
 		// assert(0 != *this && "BDBImpl is not proper initiated");
 
-		if(0 == err_log_) return;
-
 		std::pair<int, int> err = pools_[dir].get_error();
 		
 		if(err.first == 0) return;
 
-		// TODO lock log
-		
-		if(0 == ftello(err_log_)){ // write column names
-			fprintf(err_log_, "Pool_ID  Line Message\n");
+		opt_unique_lock lk(log_mutex_, boost::defer_lock);
+		if(err_log_){
+			lk.lock();
+			if(0 == ftello(err_log_)){ // write column names
+				fprintf(err_log_, "Pool_ID  Line Message\n");
+			}
 		}
 
 		while(1){
-			fprintf(err_log_, "%08x %4d %s\n", dir, err.second, error_num_to_str()(err.first));
+			if(err.first > 0 && err.first < Stat::ERROR_SLOTS)
+				err_cnt_[err.first].fetch_add(1, boost::memory_order_relaxed);
+			if(err_log_)
+				fprintf(err_log_, "%08x %4d %s\n", dir, err.second, error_num_to_str()(err.first));
 			err = pools_[dir].get_error();
 			if(err.first == 0) break;
 		}
-
-		// TODO unlock
 	}
 
 } // end of namespace BDB
@@ -5,9 +5,38 @@
 #include <string>
 #include "common.hpp"
 #include "addr_eval.hpp"
+#include "lock.hpp"
+#include "epoch.hpp"
+#include "access_log.hpp"
+#include "lat_stat.hpp"
+#include "trace_scope.hpp"
+#include "profile_scope.hpp"
 #include "boost/unordered_map.hpp"
-#include "boost/unordered_set.hpp"
+#include "boost/circular_buffer.hpp"
+#include "boost/thread/thread.hpp"
 #include "boost/pool/object_pool.hpp"
+#include <deque>
+#include <utility>
+#include <vector>
+
+// Number of lock stripes that serialize operations to the same address
+#define ADDR_LOCK_CNT 256
+
+// Stream buffers are flushed on boundaries of this size within a chunk
+#define STREAM_ALIGN 4096
+
+// Read-ahead window of input streams starts at READAHEAD_MIN and 
+// doubles on each hint up to READAHEAD_MAX
+#define READAHEAD_MIN (64*1024)
+#define READAHEAD_MAX (4*1024*1024)
+
+// Retired chunks that reclaim frees in one batch held on the stack
+#define RECLAIM_BATCH 64
+
+// Initial capacity of the limbo ring, doubled when it is full
+#define LIMBO_INIT 256
+
+struct ChunkHeader;
 
 namespace BDB {
 	
@@ -39,6 +68,21 @@ namespace BDB {
 
 		AddrType
 		put(char const *data, size_t size, AddrType addr, size_t off=npos);
+		
+		size_t
+		put_batch(Segment const* segs, size_t cnt, AddrType *addrs);
+
+		size_t
+		append(WriteVector const* wvs, size_t cnt);
+
+		AddrType
+		putv(Segment const* segs, size_t cnt);
+
+		AddrType
+		appendv(Segment const* segs, size_t cnt, AddrType addr);
+
+		AddrType
+		put_from_fd(int fd, size_t size);
 			
 		AddrType
 		put(std::string const& data)
@@ -61,12 +105,35 @@ namespace BDB {
 		size_t
 		get(std::string *output, size_t max, AddrType addr, size_t off=0);
 
+		size_t
+		getv(MutableSegment const* segs, size_t cnt, AddrType addr, 
+			size_t off=0);
+
+		size_t
+		get_batch(AddrType const* addrs, size_t cnt, 
+			char* const* buffers, size_t *sizes);
+
+		View
+		view(AddrType addr, size_t off=0, size_t size=npos);
+
+		void
+		release(View const& v);
+
+		size_t
+		send_to_fd(AddrType addr, int fd, size_t off=0, size_t size=npos);
+
 		size_t
 		del(AddrType addr);
 
 		size_t
 		del(AddrType addr, size_t off, size_t size);
 
+		size_t
+		del_batch(AddrType const* addrs, size_t cnt);
+
+		size_t
+		del_range(AddrType first, AddrType last);
+
 		// streaming interface
 		stream_state const*
 		ostream(size_t stream_size);
@@ -79,6 +146,9 @@ namespace BDB {
 		
 		stream_state const*
 		stream_write(stream_state const* state, char const* data, size_t size);
+
+		stream_state const*
+		stream_write_from_fd(stream_state const* state, int fd, size_t size);
 		
 		stream_state const*
 		stream_read(stream_state const* state, char* output, size_t size);
@@ -89,6 +159,9 @@ namespace BDB {
 		size_t
 		stream_pause(stream_state const* state);
 
+		stream_state const*
+		stream_buffer(stream_state const* state, size_t size);
+
 		stream_state const*
 		stream_resume(size_t encrypt_handle);
 		
@@ -108,6 +181,8 @@ namespace BDB {
 		end() const;
 		
 		void stat(Stat* s) const;
+
+		void metrics(std::string *out) const;
 		
 		bool full() const;
 
@@ -123,24 +198,153 @@ namespace BDB {
 		// handle error triggered in BDBImpl
 		void
 		error(int errcode, int line);
+
+		// time an operation started at t0 on a chunk in dir and log it;
+		// dir is -1 for operations over many chunks
+		void
+		done(unsigned int acc_op, unsigned int stat_op, unsigned int dir,
+			boost::uint64_t t0, AddrType a0=0, AddrType a1=0, AddrType a2=0)
+		{
+			boost::uint64_t lat = access_log::now() - t0;
+			TRACE_SCOPE(TRACE_ACCESS_LOG, -1, -1, 0);
+			PROFILE_SCOPE(PROF_LOG);
+			lat_stat_.record(stat_op, dir, lat);
+			acc_log_.record(acc_op, t0, lat, a0, a1, a2);
+		}
+		
+		// lock stripe of an external address
+		opt_mutex&
+		addr_mutex(AddrType addr)
+		{ return addr_mutex_[addr % ADDR_LOCK_CNT]; }
+		
+		// internal address of an external one or -1 if it is not acquired
+		// lock-free; readers have to be in an epoch of epoch_
+		AddrType
+		find(AddrType addr) const;
+		
+		// free a chunk that has been unpublished from global_id_ once 
+		// no reader can reach it; pool of the chunk must be locked
+		void
+		retire(AddrType internal_addr);
+
+		// retire many chunks, locking each pool once; no lock is held
+		void
+		retire(std::vector<AddrType> &internal_addrs);
+
+		// free retired chunks that are safe to reuse; no lock is held
+		void
+		reclaim();
+
+		// queue a chunk to be freed after the current epoch;
+		// limbo_mutex_ is held
+		void
+		to_limbo(AddrType internal_addr)
+		{
+			if(limbo_.full())
+				limbo_.set_capacity(2 * limbo_.capacity());
+			limbo_.push_back(std::make_pair(epoch_.current(), internal_addr));
+		}
+		
+		// put segments to an existing address without committing it to
+		// global_id_; the chunk replaced, if any, is returned by stale 
+		// and must be retired after the commit. Multiple segments can 
+		// only be appended, i.e. off is npos
+		AddrType
+		insert(Segment const* segs, size_t cnt, AddrType addr, size_t off,
+			AddrType *stale);
+
+		// commit addr to global_id_ then retire stale unless it is -1
+		bool
+		publish(AddrType addr, AddrType stale);
+
+		// register a reader of addr in in_reading_ so that its chunk 
+		// is pinned rather than freed; returns the internal address 
+		// or -1. No lock is held
+		AddrType
+		begin_reading(AddrType addr, ChunkHeader *header);
+
+		// drop a reader registered in in_reading_; the last one frees
+		// the chunk if it was retired meanwhile. No lock is held
+		void
+		end_reading(AddrType internal_addr);
+
+		// make room for size more bytes in an output stream, growing 
+		// it if possible; -1 marks the stream as failed
+		int
+		stream_reserve(stream_state *ss, size_t size);
+
+		// move a growable output stream to a chunk of a larger pool 
+		// with room for need bytes; -1 marks the stream as failed
+		int
+		stream_grow(stream_state *ss, size_t need);
+
+		// write pending data of an output stream; -1 marks the 
+		// stream as failed
+		int
+		stream_flush(stream_state *ss);
+
+		// restore paused output streams journaled in fname and 
+		// compact the journal; called once by init_
+		void
+		init_streams(char const* fname);
+
+		// free chunks referred by neither an address nor a paused 
+		// stream, e.g. destination of streams alive at a crash; 
+		// called once by init_
+		void
+		reclaim_orphans();
+
+		// body of metrics_writer_
+		void
+		write_metrics();
+
+		// lock pool other_dir while pool held_dir is locked by held
+		void
+		lock_also(opt_unique_lock &held, unsigned int held_dir,
+			opt_unique_lock &other, unsigned int other_dir);
 	
 	private:
 		typedef boost::unordered_map<AddrType, unsigned int> AddrCntCont;
-		typedef boost::unordered_set<size_t> EncStreamCont;
+		typedef boost::unordered_map<size_t, stream_state*> EncStreamCont;
+		// a ring rather than a deque, which allocates as it moves
+		typedef boost::circular_buffer<std::pair<size_t, AddrType> > LimboCont;
 		
 		addr_eval<AddrType> addrEval;
 		pool* pools_;
 		FILE* err_log_;
 		char err_log_buf_[256];
 		
-		FILE* acc_log_;
-		char acc_log_buf_[4096];
+		access_log acc_log_;
+		lat_stat lat_stat_;
+		boost::atomic<unsigned long long> err_cnt_[Stat::ERROR_SLOTS];
 		IDValPool *global_id_;
 		
+		size_t stream_buf_size_;
 		AddrCntCont in_reading_;
-		// TODO two containers as follows are not recoverable
+		// paused streams by handle; output ones are journaled in 
+		// stream_log_ and restored by init_streams
 		EncStreamCont enc_stream_state_;
+		size_t next_handle_;
+		FILE* stream_log_;
 		boost::object_pool<stream_state> stream_state_pool_;
+		
+		// retired chunks tagged with epoch
+		epoch_manager epoch_;
+		LimboCont limbo_;
+
+		// writes metrics_file_ every metrics_interval_ seconds
+		std::string metrics_file_;
+		unsigned int metrics_interval_;
+		boost::thread metrics_writer_;
+		
+		// Lock order: addr_mutex_ -> pool mutexes (ascending dirID) -> 
+		// stream_mutex_ -> gid_mutex_ -> limbo_mutex_ -> log_mutex_
+		// Readers of global_id_ (Find/isAcquired) need no lock.
+		opt_mutex addr_mutex_[ADDR_LOCK_CNT];
+		opt_mutex stream_mutex_; // in_reading_, enc_stream_state_, stream_log_, stream_state_pool_
+		mutable opt_mutex gid_mutex_; // writers of global_id_
+		opt_mutex limbo_mutex_; // limbo_
+		opt_mutex log_mutex_; // err_log_
 	};
 
 } // end of namespace BDB
@@ -0,0 +1,121 @@
+#include "buf_pool.hpp"
+#include "boost/thread/thread.hpp"
+
+namespace BDB {
+
+	buf_pool&
+	buf_pool::instance()
+	{
+		// outlives thread caches cleaned up at exit
+		static buf_pool *inst = new buf_pool;
+		return *inst;
+	}
+
+	buf_pool::buf_pool()
+	: live_cnt_(0), max_cnt_(1), 
+	  hits_(0), misses_(0), cache_(&buf_pool::cache_cleanup)
+	{
+		// one buffer for each thread that may migrate at once
+		unsigned int cnt = boost::thread::hardware_concurrency();
+		if(cnt) max_cnt_.store(cnt, boost::memory_order_relaxed);
+	}
+
+	char*
+	buf_pool::borrow()
+	{
+		char **slot = cache_.get();
+		char *rt = slot ? *slot : 0;
+		if(rt)
+			*slot = 0;
+		else{
+			boost::lock_guard<boost::mutex> lk(mutex_);
+			if(!free_.empty()){
+				rt = free_.back();
+				free_.pop_back();
+			}
+		}
+		if(rt){
+			hits_.fetch_add(1, boost::memory_order_relaxed);
+			return rt;
+		}
+		rt = new char[MIGBUF_SIZ];
+		live_cnt_.fetch_add(1, boost::memory_order_relaxed);
+		misses_.fetch_add(1, boost::memory_order_relaxed);
+		return rt;
+	}
+
+	void
+	buf_pool::give_back(char *buf)
+	{
+		if(!buf) return;
+		
+		bool keep = live_cnt_.load(boost::memory_order_relaxed) <= 
+			max_cnt_.load(boost::memory_order_relaxed);
+		if(keep){
+			char **slot = cache_.get();
+			if(!slot)
+				cache_.reset(slot = new char*(0));
+			if(0 == *slot){
+				*slot = buf;
+				return;
+			}
+			boost::lock_guard<boost::mutex> lk(mutex_);
+			free_.push_back(buf);
+			return;
+		}
+		delete [] buf;
+		live_cnt_.fetch_sub(1, boost::memory_order_relaxed);
+	}
+
+	void
+	buf_pool::retention(size_t bytes)
+	{
+		size_t cnt = bytes / MIGBUF_SIZ;
+		max_cnt_.store(cnt ? cnt : 1, boost::memory_order_relaxed);
+		
+		boost::lock_guard<boost::mutex> lk(mutex_);
+		shrink();
+	}
+
+	size_t
+	buf_pool::retention() const
+	{ return max_cnt_.load(boost::memory_order_relaxed) * MIGBUF_SIZ; }
+
+	size_t
+	buf_pool::allocated() const
+	{ return live_cnt_.load(boost::memory_order_relaxed) * MIGBUF_SIZ; }
+
+	size_t
+	buf_pool::hits() const
+	{ return hits_.load(boost::memory_order_relaxed); }
+
+	size_t
+	buf_pool::misses() const
+	{ return misses_.load(boost::memory_order_relaxed); }
+
+	void
+	buf_pool::cache_cleanup(char **slot)
+	{
+		if(*slot){
+			buf_pool &bp = instance();
+			boost::lock_guard<boost::mutex> lk(bp.mutex_);
+			bp.free_.push_back(*slot);
+			bp.shrink();
+		}
+		delete slot;
+	}
+
+	void
+	buf_pool::shrink()
+	{
+		while(!free_.empty() && 
+			live_cnt_.load(boost::memory_order_relaxed) > 
+			max_cnt_.load(boost::memory_order_relaxed))
+		{
+			delete [] free_.back();
+			free_.pop_back();
+			live_cnt_.fetch_sub(1, boost::memory_order_relaxed);
+		}
+	}
+
+} // end of namespace BDB
@@ -0,0 +1,104 @@
+#ifndef _BDB_BUF_POOL_HPP
+#define _BDB_BUF_POOL_HPP
+
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/locks.hpp"
+#include "boost/thread/tss.hpp"
+#include "boost/atomic.hpp"
+#include <cstddef>
+#include <vector>
+
+// Size of a migration buffer
+#define MIGBUF_SIZ (2*1024*1024)
+
+namespace BDB {
+
+	/** @brief Process-wide pool of migration buffers
+	 *  @details Pools borrow a buffer of MIGBUF_SIZ bytes for an
+	 *  operation and give it back afterwards. Each thread keeps one
+	 *  buffer in its own cache so that the hot buffer stays in CPU
+	 *  cache and no lock is taken in the common case.
+	 *  Buffers given back while more than retention() bytes are 
+	 *  allocated are freed, so idle memory is capped by retention() but
+	 *  buffers in use are not: borrowing never blocks since idle threads
+	 *  may hold buffers in their caches. Retention defaults to one 
+	 *  buffer per hardware thread.
+	 */
+	class buf_pool
+	{
+	public:
+		/// The only instance, never destroyed
+		static buf_pool&
+		instance();
+
+		char*
+		borrow();
+
+		void
+		give_back(char *buf);
+
+		/// Set cap of retained buffers in bytes, at least one buffer
+		void
+		retention(size_t bytes);
+
+		size_t
+		retention() const;
+
+		/// Bytes of buffers allocated, including those borrowed
+		size_t
+		allocated() const;
+
+		/// Borrowings served by retained buffers
+		size_t
+		hits() const;
+
+		/// Borrowings that allocated a buffer
+		size_t
+		misses() const;
+
+		/// Scoped borrowing
+		struct buffer
+		{
+			buffer()
+			: buf_(buf_pool::instance().borrow())
+			{}
+
+			~buffer()
+			{ buf_pool::instance().give_back(buf_); }
+
+			char*
+			get() const
+			{ return buf_; }
+
+		private:
+			buffer(buffer const &cp);
+			buffer& operator=(buffer const &cp);
+			char *buf_;
+		};
+
+	private:
+		buf_pool();
+		buf_pool(buf_pool const &cp);
+		buf_pool& operator=(buf_pool const &cp);
+
+		// give back the buffer cached by an exiting thread
+		static void
+		cache_cleanup(char **slot);
+
+		// release retained buffers over retention; lock is held
+		void
+		shrink();
+
+		boost::mutex mutex_; // free_
+		std::vector<char*> free_;
+		boost::atomic<size_t> live_cnt_;
+		boost::atomic<size_t> max_cnt_;
+		boost::atomic<size_t> hits_, misses_;
+		// slot of a thread is kept while its buffer is borrowed, 
+		// so that caching it again does not allocate
+		boost::thread_specific_ptr<char*> cache_;
+	};
+
+} // end of namespace BDB
+
+#endif // end of header
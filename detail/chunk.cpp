@@ -3,7 +3,6 @@
 #include <cstdlib>
 #include <cstring>
 #include <istream>
-#include <sstream>
 #include <ostream>
 #include <iomanip>
 
@@ -15,7 +14,7 @@ using std::hex;
 std::istream& 
 operator>>(std::istream &is, ChunkHeader &ch)
 {
-	static char buf[9];
+	char buf[9];
 	buf[8] = 0;
 
 	is.read(buf, 8);
@@ -50,7 +49,7 @@ operator<<(std::ostream &os, ChunkHeader const &ch)
 FILE*
 operator>>(FILE* fp, ChunkHeader &ch)
 {
-	static char buf[9];
+	char buf[9];
 	buf[8] = 0;
 	// first byte is preserved
 	if(8 != fread(buf, 1, 8, fp)){
@@ -63,11 +62,9 @@ operator>>(FILE* fp, ChunkHeader &ch)
 FILE*
 operator<<(FILE* fp, ChunkHeader const &ch)
 {
-	using namespace std;
-	stringstream cvt;
-	cvt<<setfill('0')<<setw(8)<<hex<<ch.size;
-
-	if( 8 != fwrite(cvt.str().c_str(), 1, 8, fp))
+	char text[8];
+	format_header(text, ch);
+	if( 8 != fwrite(text, 1, 8, fp))
 		return 0;
 	/*
 	if(0 >  fprintf(fp, "%08x", ch.size)){
@@ -82,7 +79,7 @@ operator<<(FILE* fp, ChunkHeader const &ch)
 int
 read_header(FILE* fp, ChunkHeader &ch)
 {
-	static char buf[9];
+	char buf[9];
 	buf[8] = 0;
 	// first byte is preserved
 	if(8 != fread(buf, 1, 8, fp)){
@@ -92,6 +89,26 @@ read_header(FILE* fp, ChunkHeader &ch)
 	return 0;
 }
 
+int
+read_header(char const* text, ChunkHeader &ch)
+{
+	char buf[9];
+	buf[8] = 0;
+	memcpy(buf, text, 8);
+	// first byte is preserved
+	ch.size = strtoul(&buf[1], 0, 16);
+	return 0;
+}
+
+void
+format_header(char *text, ChunkHeader const &ch)
+{
+	static char const digits[] = "0123456789abcdef";
+	size_t size = ch.size;
+	for(int i=7; i>=0; --i, size >>= 4)
+		text[i] = digits[size & 0xf];
+}
+
 int
 write_header(FILE* fp, ChunkHeader const& ch)
 {	
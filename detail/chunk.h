@@ -32,5 +32,17 @@ write_header(FILE* fp, ChunkHeader const &ch);
 int
 read_header(FILE* fp, ChunkHeader &ch);
 
+/** Parse a header from its text form
+ *  @param text At least 8 characters written by write_header
+ */
+int
+read_header(char const* text, ChunkHeader &ch);
+
+/** Format a header to its text form without allocation
+ *  @param text At least 8 characters, not terminated
+ */
+void
+format_header(char *text, ChunkHeader const &ch);
+
 #endif
 
@@ -20,7 +20,12 @@ namespace BDB {
 		char const *header_dir,
 		char const *log_dir,
 		Chunk_size_est cse_func,
-		Capacity_test ct_func 
+		Capacity_test ct_func,
+		bool concurrent,
+		size_t stream_buf_size,
+		unsigned int access_log_sample,
+		size_t access_log_ring,
+		unsigned int metrics_interval
 	)
 	// initialization list
 	: beg(beg), end(end),
@@ -28,7 +33,10 @@ namespace BDB {
 	root_dir(root_dir), pool_dir(pool_dir), 
 	trans_dir(trans_dir), header_dir(header_dir), log_dir(log_dir),
 	cse_func(cse_func), 
-	ct_func(ct_func)
+	ct_func(ct_func), concurrent(concurrent),
+	stream_buf_size(stream_buf_size),
+	access_log_sample(access_log_sample), access_log_ring(access_log_ring),
+	metrics_interval(metrics_interval)
 	{ validate(); }
 
 	void
@@ -58,6 +66,9 @@ namespace BDB {
 		if(*log_dir && PATH_DELIM != log_dir[strlen(log_dir)-1])
 			throw invalid_argument("Config: non-empty log_dir should be ended with a path delimiter");
 		
+		if(metrics_interval && !concurrent)
+			throw invalid_argument("Config: metrics_interval needs concurrent to be true");
+
 		if( (*cse_func)(0, min_size) >= (*cse_func)(1, min_size) )
 			throw invalid_argument("Config: chunk_size_est should maintain strict weak ordering of chunk size");
 		
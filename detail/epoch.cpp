@@ -0,0 +1,64 @@
+#include "epoch.hpp"
+#include "boost/thread/thread.hpp"
+#include "boost/functional/hash.hpp"
+
+namespace BDB {
+	
+	epoch_manager::epoch_manager()
+	: epoch_(2)
+	{
+		for(unsigned int i=0; i<2; ++i)
+			for(unsigned int j=0; j<EPOCH_STRIPE_CNT; ++j)
+				cnt_[i][j].cnt.store(0, boost::memory_order_relaxed);
+	}
+	
+	unsigned int
+	epoch_manager::enter()
+	{
+		unsigned int stripe = 
+			boost::hash<boost::thread::id>()(boost::this_thread::get_id()) 
+			% EPOCH_STRIPE_CNT;
+		unsigned int parity = epoch_.load(boost::memory_order_seq_cst) & 1;
+		
+		// seq_cst orders this increment before any lookup of readers
+		cnt_[parity][stripe].cnt.fetch_add(1, boost::memory_order_seq_cst);
+		return stripe << 1 | parity;
+	}
+
+	void
+	epoch_manager::leave(unsigned int token)
+	{
+		cnt_[token & 1][token >> 1].cnt.fetch_sub(1, boost::memory_order_release);
+	}
+
+	size_t
+	epoch_manager::current() const
+	{ return epoch_.load(boost::memory_order_seq_cst); }
+
+	size_t
+	epoch_manager::advance()
+	{
+		size_t e = epoch_.load(boost::memory_order_seq_cst);
+		
+		// readers of e-1 share parity with e+1; they must have left
+		// before the epoch can move on
+		for(int i=0; i<2; ++i){
+			if(0 != readers((e + 1) & 1))
+				break;
+			if(!epoch_.compare_exchange_strong(e, e + 1))
+				break;
+			++e;
+		}
+		return epoch_.load(boost::memory_order_seq_cst);
+	}
+
+	size_t
+	epoch_manager::readers(unsigned int parity) const
+	{
+		size_t total(0);
+		for(unsigned int i=0; i<EPOCH_STRIPE_CNT; ++i)
+			total += cnt_[parity][i].cnt.load(boost::memory_order_seq_cst);
+		return total;
+	}
+
+} // end of namespace BDB
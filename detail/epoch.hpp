@@ -0,0 +1,95 @@
+#ifndef _BDB_EPOCH_HPP
+#define _BDB_EPOCH_HPP
+
+#include "boost/atomic.hpp"
+#include <cstddef>
+
+// Reader counters are striped by thread to avoid cache line bouncing
+#define EPOCH_STRIPE_CNT 64
+
+namespace BDB {
+
+	/** @brief Epoch based reclamation for lock-free readers
+	 *  @details Readers enter the current epoch before they look up 
+	 *  a shared structure and leave after they are done with what
+	 *  they found. A writer that unpublishes an object tags it with
+	 *  current() and reclaims it once safe(tag) holds, i.e. after
+	 *  every reader that might have seen the object left.
+	 *  @code
+	 *  // reader
+	 *  epoch_manager::guard g(em);
+	 *  AddrType val = table.Find(id);
+	 *  ... use val ...
+	 *  // writer
+	 *  table.Update(id, new_val);
+	 *  limbo.push_back(make_pair(em.current(), old_val));
+	 *  ...
+	 *  em.advance();
+	 *  while(!limbo.empty() && em.safe(limbo.front().first)) 
+	 *    reclaim(limbo.front().second), limbo.pop_front();
+	 *  @endcode
+	 */
+	class epoch_manager
+	{
+	public:
+		epoch_manager();
+		
+		/// Enter current epoch. @return token for leave()
+		unsigned int
+		enter();
+		
+		void
+		leave(unsigned int token);
+		
+		/// Epoch that objects unpublished now should be tagged with
+		size_t
+		current() const;
+		
+		/** Advance epoch as far as readers allow.
+		 *  @return Current epoch
+		 */
+		size_t
+		advance();
+		
+		/// Test if objects tagged with tag can be reclaimed
+		bool
+		safe(size_t tag) const
+		{ return tag + 2 <= current(); }
+
+		/// Scoped read-side critical section
+		struct guard
+		{
+			guard(epoch_manager &em)
+			: em_(em), token_(em.enter())
+			{}
+
+			~guard()
+			{ em_.leave(token_); }
+		private:
+			guard(guard const &cp);
+			guard& operator=(guard const &cp);
+
+			epoch_manager &em_;
+			unsigned int token_;
+		};
+
+	private:
+		epoch_manager(epoch_manager const &cp);
+		epoch_manager& operator=(epoch_manager const &cp);
+
+		size_t
+		readers(unsigned int parity) const;
+
+		struct counter
+		{
+			boost::atomic<size_t> cnt;
+			char pad[64 - sizeof(boost::atomic<size_t>)];
+		};
+		
+		boost::atomic<size_t> epoch_;
+		counter cnt_[2][EPOCH_STRIPE_CNT];
+	};
+
+} // end of namespace BDB
+
+#endif // end of header
@@ -2,6 +2,9 @@
 #define FIXEDPOOL_HPP_
 
 #include "common.hpp"
+#include "sys_io.hpp"
+#include "trace_scope.hpp"
+#include "profile_scope.hpp"
 #include <string>
 #include <cstdio>
 #include <cstring>
@@ -76,6 +79,8 @@ namespace BDB {
 		int read(T* val, AddrType addr) const
 		{
 			if(!*this) return -1;
+			TRACE_SCOPE(TRACE_HEADER_READ, id_, addr, TextSize);
+			PROFILE_SCOPE(PROF_HEADER);
 
 			off_t loc_addr = addr;
 			loc_addr *= TextSize;
@@ -87,9 +92,60 @@ namespace BDB {
 			return 0;
 		}
 
+		/** Read without touching position of the pool file
+		 *  @remark Safe to call concurrently with read/write of 
+		 *  other values.
+		 */
+		int read_shared(T* val, AddrType addr) const
+		{
+			if(!*this) return -1;
+			TRACE_SCOPE(TRACE_HEADER_READ, id_, addr, TextSize);
+			PROFILE_SCOPE(PROF_HEADER);
+
+			char text[TextSize];
+			off_t loc_addr = addr;
+			loc_addr *= TextSize;
+			if(TextSize != pread_full(file_, text, TextSize, loc_addr))
+				return -1;
+			return read_header(text, *val);
+		}
+
+		/** Read values in bulk without touching position of the pool file
+		 *  @param addrs Addresses in ascending order
+		 *  @remark Consecutive addresses are read by one pread
+		 */
+		int read_shared(T* vals, AddrType const* addrs, size_t cnt) const
+		{
+			if(!*this) return -1;
+			TRACE_SCOPE(TRACE_HEADER_READ, id_, cnt ? addrs[0] : (AddrType)-1, 
+				TextSize * cnt);
+			PROFILE_SCOPE(PROF_HEADER);
+
+			char text[TextSize * 64];
+			size_t beg(0);
+			while(beg < cnt){
+				size_t end = beg + 1;
+				while(end < cnt && end - beg < 64 && 
+					addrs[end] == addrs[end-1] + 1)
+					++end;
+				off_t loc_addr = addrs[beg];
+				loc_addr *= TextSize;
+				size_t size = (end - beg) * TextSize;
+				if(size != pread_full(file_, text, size, loc_addr))
+					return -1;
+				for(size_t i=beg; i<end; ++i)
+					if(-1 == read_header(text + (i-beg)*TextSize, vals[i]))
+						return -1;
+				beg = end;
+			}
+			return 0;
+		}
+
 		int write(T const & val, AddrType addr)
 		{
 			if(!*this) return -1;
+			TRACE_SCOPE(TRACE_HEADER_WRITE, id_, addr, TextSize);
+			PROFILE_SCOPE(PROF_HEADER);
 
 			off_t loc_addr = addr;
 			loc_addr *= TextSize;
@@ -100,6 +156,29 @@ namespace BDB {
 			fflush(file_);
 			return 0;
 		}
+
+		/** Write values in bulk with a single flush
+		 *  @remark Seek is skipped between consecutive addresses
+		 */
+		int write(T const* vals, AddrType const* addrs, size_t cnt)
+		{
+			if(!*this) return -1;
+			TRACE_SCOPE(TRACE_HEADER_WRITE, id_, cnt ? addrs[0] : (AddrType)-1, 
+				TextSize * cnt);
+			PROFILE_SCOPE(PROF_HEADER);
+
+			for(size_t i=0; i<cnt; ++i){
+				if(0 == i || addrs[i] != addrs[i-1] + 1){
+					off_t loc_addr = addrs[i];
+					loc_addr *= TextSize;
+					if(-1 == fseeko(file_, loc_addr, SEEK_SET))
+						return -1;
+				}
+				if( 0 == file_<<vals[i] ) return -1;
+			}
+			if(ferror(file_) || 0 != fflush(file_)) return -1;
+			return 0;
+		}
 	
 		std::string
 		dir() const 
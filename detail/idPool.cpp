@@ -1,4 +1,6 @@
 #include "idPool.hpp"
+#include "trace_scope.hpp"
+#include "profile_scope.hpp"
 
 #include <stdexcept>
 #include <limits>
@@ -8,6 +10,7 @@
 #include <cerrno>
 #include <cassert>
 #include <sstream>
+#include "boost/static_assert.hpp"
 //#include "boost/system/error_code.hpp"
 
 namespace BDB { 
@@ -16,6 +19,8 @@ namespace BDB {
 	int
 	IDPool::write(char const* data, size_t size)
 	{
+		TRACE_SCOPE(TRACE_COMMIT, -1, -1, size);
+		PROFILE_SCOPE(PROF_COMMIT);
 		// using namespace boost::system;
 		
 		while(size>0){
@@ -169,13 +174,83 @@ namespace BDB {
 		return 0;
 	}
 
+	void
+	IDPool::record_buf::add(char symbol, AddrType a)
+	{
+		// longest record is a symbol, two IDs, a tab and a newline
+		if(len_ + 24 > TRANS_REC_BUF) flush();
+		buf_[len_++] = symbol;
+		put_uint(a);
+		buf_[len_++] = '\n';
+	}
+
+	void
+	IDPool::record_buf::add(char symbol, AddrType a, AddrType b)
+	{
+		if(len_ + 24 > TRANS_REC_BUF) flush();
+		buf_[len_++] = symbol;
+		put_uint(a);
+		buf_[len_++] = '\t';
+		put_uint(b);
+		buf_[len_++] = '\n';
+	}
+
+	bool
+	IDPool::record_buf::flush()
+	{
+		if(len_ && -1 == pool_.write(buf_, len_))
+			failed_ = true;
+		len_ = 0;
+		return !failed_;
+	}
+
+	void
+	IDPool::record_buf::put_uint(AddrType v)
+	{
+		char digits[16];
+		int n(0);
+		do{
+			digits[n++] = '0' + v % 10;
+			v /= 10;
+		}while(v);
+		while(n) buf_[len_++] = digits[--n];
+	}
+
+	void
+	IDPool::parse_release(char const* text, AddrType *first, AddrType *last)
+	{
+		char *end(0);
+		*first = strtoul(text, &end, 10);
+		*last = ('\t' == *end) ? strtoul(end + 1, 0, 10) : *first + 1;
+	}
+
 	bool
 	IDPool::Commit(AddrType const& id)
 	{
-		std::stringstream ss;
-		char symbol = bm_[id-beg_] ? '-' : '+';
-		ss<<symbol<<(id-beg_)<<"\n";
-		return -1 != write(ss.str().c_str(), ss.str().size());
+		record_buf rec(*this);
+		rec.add(bm_[id-beg_] ? '-' : '+', id-beg_);
+		return rec.flush();
+	}
+
+	bool
+	IDPool::Commit(AddrType const* ids, size_t cnt)
+	{
+		record_buf rec(*this);
+		for(size_t i=0; i<cnt; ++i){
+			if(!bm_[ids[i]-beg_]){
+				rec.add('+', ids[i]-beg_);
+				continue;
+			}
+			size_t j = i + 1;
+			while(j < cnt && ids[j] == ids[j-1] + 1 && bm_[ids[j]-beg_])
+				++j;
+			if(j - i > 1)
+				rec.add('-', ids[i]-beg_, ids[j-1]-beg_+1);
+			else
+				rec.add('-', ids[i]-beg_);
+			i = j - 1;
+		}
+		return rec.flush();
 	}
 
 	void
@@ -234,9 +309,9 @@ namespace BDB {
 		if(0 == tfile) // no transaction files for replaying
 			return;
 
-		char line[21] = {0};		
-		AddrType off;
-		while(fgets(line, 20, tfile)){
+		char line[32] = {0};		
+		AddrType off, last;
+		while(fgets(line, sizeof(line), tfile)){
 			line[strlen(line)-1] = 0;
 			off = strtoul(&line[1], 0, 10);
 			if('+' == line[0]){
@@ -249,7 +324,10 @@ namespace BDB {
 				bm_[off] = false;
 				if(max_used_ <= off) max_used_ = off+1;
 			}else if('-' == line[0]){
-				bm_[off] = true;
+				parse_release(&line[1], &off, &last);
+				if(last > bm_.size()) last = bm_.size();
+				if(off < last)
+					bm_.set(off, last - off, true);
 			}
 		}
 		fclose(tfile);
@@ -296,7 +374,9 @@ namespace BDB {
 	IDValPool::IDValPool(char const* tfile, AddrType beg, AddrType end)
 	: super(beg, end), arr_(0)
 	{
-		arr_ = new AddrType[end - beg];
+		BOOST_STATIC_ASSERT(sizeof(Slot) == sizeof(AddrType));
+
+		arr_ = static_cast<Slot*>(calloc(end - beg, sizeof(Slot)));
 		if(!arr_) throw std::bad_alloc();
 
 		replay_transaction(tfile);
@@ -306,7 +386,7 @@ namespace BDB {
 	
 	IDValPool::~IDValPool()
 	{
-		delete [] arr_;	
+		free(arr_);	
 	}
 
 	
@@ -317,11 +397,20 @@ namespace BDB {
 		AddrType rt;
 		if(-1 == (rt = super::Acquire()))
 			return -1;
-		arr_[rt - super::begin()] = val;
+		arr_[rt - super::begin()].store(val + 1, boost::memory_order_release);
 		
 		return rt;
 		
 	}
+
+	int
+	IDValPool::Release(AddrType const &id)
+	{
+		if(-1 == super::Release(id))
+			return -1;
+		arr_[id - super::begin()].store(0, boost::memory_order_release);
+		return 0;
+	}
 	
 	bool IDValPool::avail() const
 	{
@@ -336,15 +425,39 @@ namespace BDB {
 		if(super::bm_[off]) 
 			return super::Commit(id);
 
-		std::stringstream ss;
-		ss<<"+"<<(off)<<"\t"<<arr_[off]<<"\n";
-		return -1 != write(ss.str().c_str(), ss.str().size());
+		record_buf rec(*this);
+		rec.add('+', off, Find(id));
+		return rec.flush();
+	}
+	
+	bool 
+	IDValPool::Commit(AddrType const* ids, size_t cnt)
+	{
+		record_buf rec(*this);
+		for(size_t i=0; i<cnt; ++i){
+			AddrType off = ids[i] - begin();
+			if(!super::bm_[off]){
+				rec.add('+', off, Find(ids[i]));
+				continue;
+			}
+			size_t j = i + 1;
+			while(j < cnt && ids[j] == ids[j-1] + 1 && 
+				super::bm_[ids[j] - begin()])
+				++j;
+			if(j - i > 1)
+				rec.add('-', off, off + j - i);
+			else
+				rec.add('-', off);
+			i = j - 1;
+		}
+		return rec.flush();
 	}
 	
 	AddrType IDValPool::Find(AddrType const & id) const
 	{
-		assert(true == super::isAcquired(id) && "IDValPool: Test isAcquired before Find!");
-		return arr_[ id - super::beg_ ];
+		if(id - super::beg_ >= super::end_ - super::beg_)
+			return -1;
+		return arr_[ id - super::beg_ ].load(boost::memory_order_acquire) - 1;
 	}
 
 
@@ -362,7 +475,7 @@ namespace BDB {
 		if(ss.str().size() != fwrite(ss.str().c_str(), 1, ss.str().size(), super::file_))
 			throw std::runtime_error("IDValPool(Update): write transaction failure");
 		*/
-		arr_[id - super::beg_] = val;
+		arr_[id - super::beg_].store(val + 1, boost::memory_order_release);
 
 	}
 
@@ -378,11 +491,11 @@ namespace BDB {
 			return;
 		
 
-		char line[21] = {0};		
+		char line[32] = {0};		
 		AddrType off; 
-		AddrType val;
+		AddrType val, last;
 		std::stringstream cvt;
-		while(fgets(line, 20, tfile)){
+		while(fgets(line, sizeof(line), tfile)){
 			line[strlen(line)-1] = 0;
 			cvt.clear();
 			cvt.str(line +1);
@@ -392,13 +505,18 @@ namespace BDB {
 				if(super::bm_.size() <= off)
 					throw std::runtime_error("IDValPool: ID in trans file does not fit into idPool");
 				super::bm_[off] = false;
-				arr_[off] = val;
+				arr_[off].store(val + 1, boost::memory_order_relaxed);
 				if(off >= super::max_used_)
 					super::max_used_ = off+1;
 			}else if('-' == line[0]){
-				super::bm_[off] = true;
+				super::parse_release(line + 1, &off, &last);
+				if(last > super::bm_.size()) last = super::bm_.size();
+				for(AddrType i = off; i < last; ++i)
+					arr_[i].store(0, boost::memory_order_relaxed);
+				if(off < last)
+					super::bm_.set(off, last - off, true);
 			}
-			assert(0 != cvt && "IDValPool: Read id-val pair failed");
+			assert(!cvt.fail() && "IDValPool: Read id-val pair failed");
 		}
 		fclose(tfile);
 		
@@ -4,9 +4,13 @@
 #include <cstdio>
 #include <limits>
 #include "boost/dynamic_bitset.hpp"
+#include "boost/atomic.hpp"
 #include "common.hpp"
 
 
+// Bytes of transaction records formatted before they are written
+#define TRANS_REC_BUF 512
+
 namespace BDB {
 
 	/// @todo TODO: Transaction file compression (snapshot).
@@ -93,6 +97,13 @@ namespace BDB {
 
 		bool
 		Commit(AddrType const&id);
+		
+		/** Commit many IDs with one write to the transaction file
+		 *  @remark Runs of consecutive released IDs are recorded
+		 *  as ranges.
+		 */
+		bool
+		Commit(AddrType const* ids, size_t cnt);
 
 		void
 		Lock(AddrType const &id);
@@ -127,6 +138,42 @@ namespace BDB {
 		num_blocks() const;
 		
 	protected:
+		/** @brief Transaction records formatted in a stack buffer
+		 *  @details The buffer is written when it can not hold one 
+		 *  more record; flush() writes the rest.
+		 */
+		class record_buf
+		{
+		public:
+			explicit record_buf(IDPool &pool)
+			: pool_(pool), len_(0), failed_(false)
+			{}
+
+			// "<symbol><a>\n"
+			void
+			add(char symbol, AddrType a);
+
+			// "<symbol><a>\t<b>\n"
+			void
+			add(char symbol, AddrType a, AddrType b);
+
+			/// @return false if any write failed
+			bool
+			flush();
+
+		private:
+			record_buf(record_buf const &cp);
+			record_buf& operator=(record_buf const &cp);
+
+			void
+			put_uint(AddrType v);
+
+			IDPool &pool_;
+			size_t len_;
+			bool failed_;
+			char buf_[TRANS_REC_BUF];
+		};
+
 		void 
 		replay_transaction(char const* transaction_file);
 		
@@ -135,6 +182,11 @@ namespace BDB {
 
 		int 
 		write(char const *data, size_t size);
+
+		// parse rest of a release record, i.e. "off" or "first\tlast",
+		// into offsets [*first, *last)
+		static void
+		parse_release(char const* text, AddrType *first, AddrType *last);
 		
 		/** Extend bitmap size to 1.5 times large
 		 *  @throw std::bad_alloc
@@ -158,6 +210,9 @@ namespace BDB {
 	};
 
 	/** @brief Extend IDPool<B> for associating a value with an ID.
+	 *  @details Find() and isAcquired() are lock-free and can run 
+	 *  concurrently with one writer that calls other methods. 
+	 *  Writers have to be serialized by clients.
 	 */
 	class IDValPool : public IDPool
 	{
@@ -173,16 +228,29 @@ namespace BDB {
 		 */
 		AddrType Acquire(AddrType const &val);
 		
+		int
+		Release(AddrType const &id);
+		
+		/** Test if an ID exists
+		 *  @remark Lock-free
+		 */
+		bool 
+		isAcquired(AddrType const &id) const
+		{ return (AddrType)-1 != Find(id); }
+		
 		bool 
 		avail() const;
 
 		bool 
 		Commit(AddrType const &id);
+		
+		bool
+		Commit(AddrType const* ids, size_t cnt);
 
 		/** Find value by ID
 		 * @param id
-		 * @pre id exists in an IDValPool (Test it by isAcquire())
-		 * @return Associated value
+		 * @return Associated value or -1 if id is not acquired
+		 * @remark Lock-free
 		 */
 		AddrType Find(AddrType const &id) const;
 		
@@ -198,7 +266,10 @@ namespace BDB {
 
 		// size_t block_size() const;
 	private:
-		AddrType* arr_;
+		// Slots hold (value + 1); zero marks a free ID so that the 
+		// table can be calloc'd and paged in lazily
+		typedef boost::atomic<AddrType> Slot;
+		Slot* arr_;
 	};
 } // end of namespace BDB
 
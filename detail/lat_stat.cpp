@@ -0,0 +1,129 @@
+#include "lat_stat.hpp"
+#include "boost/thread/tss.hpp"
+
+namespace BDB {
+
+	namespace {
+
+		// stripes are dealt to threads in turn on their first record
+		boost::thread_specific_ptr<unsigned int> stripe_of_thread;
+		boost::atomic<unsigned int> next_stripe(0);
+
+		unsigned int
+		this_stripe()
+		{
+			unsigned int *s = stripe_of_thread.get();
+			if(0 == s){
+				s = new unsigned int(next_stripe.fetch_add(1, 
+					boost::memory_order_relaxed) % LAT_STAT_STRIPES);
+				stripe_of_thread.reset(s);
+			}
+			return *s;
+		}
+
+	} // end of anonymous namespace
+
+	lat_stat::lat_stat()
+	: dir_cnt_(0), cells_(0), migrations_(0), migrated_bytes_(0)
+	{}
+
+	lat_stat::~lat_stat()
+	{
+		for(unsigned int i=0; i<LAT_STAT_STRIPES * dir_cnt_; ++i)
+			delete cells_[i].load(boost::memory_order_relaxed);
+		delete [] cells_;
+		delete [] migrations_;
+		delete [] migrated_bytes_;
+	}
+
+	void
+	lat_stat::init(unsigned int dir_cnt)
+	{
+		dir_cnt_ = dir_cnt;
+		cells_ = new boost::atomic<cell*>[LAT_STAT_STRIPES * dir_cnt];
+		for(unsigned int i=0; i<LAT_STAT_STRIPES * dir_cnt; ++i)
+			cells_[i].store(0, boost::memory_order_relaxed);
+		migrations_ = new boost::atomic<boost::uint64_t>[dir_cnt];
+		migrated_bytes_ = new boost::atomic<boost::uint64_t>[dir_cnt];
+		for(unsigned int i=0; i<dir_cnt; ++i){
+			migrations_[i].store(0, boost::memory_order_relaxed);
+			migrated_bytes_[i].store(0, boost::memory_order_relaxed);
+		}
+	}
+
+	lat_stat::cell*
+	lat_stat::get_cell(unsigned int dir)
+	{
+		boost::atomic<cell*> &slot = cells_[this_stripe() * dir_cnt_ + dir];
+		cell *c = slot.load(boost::memory_order_acquire);
+		if(c) return c;
+
+		c = new cell;
+		for(unsigned int i=0; i<STAT_OP_CNT; ++i){
+			hist &h = c->op[i];
+			for(unsigned int b=0; b<LatencyHist::BUCKETS; ++b)
+				h.count[b].store(0, boost::memory_order_relaxed);
+			h.total.store(0, boost::memory_order_relaxed);
+			h.max.store(0, boost::memory_order_relaxed);
+		}
+		cell *expected = 0;
+		if(!slot.compare_exchange_strong(expected, c, 
+			boost::memory_order_acq_rel))
+		{
+			delete c;
+			c = expected;
+		}
+		return c;
+	}
+
+	void
+	lat_stat::record(unsigned int op, unsigned int dir, boost::uint64_t ns)
+	{
+		if(dir >= dir_cnt_) return;
+		hist &h = get_cell(dir)->op[op];
+		h.count[LatencyHist::bucket(ns)].fetch_add(1, boost::memory_order_relaxed);
+		h.total.fetch_add(ns, boost::memory_order_relaxed);
+		boost::uint64_t m = h.max.load(boost::memory_order_relaxed);
+		while(ns > m && 
+			!h.max.compare_exchange_weak(m, ns, boost::memory_order_relaxed))
+			;
+	}
+
+	void
+	lat_stat::migrated(unsigned int dir, size_t bytes)
+	{
+		if(dir >= dir_cnt_) return;
+		migrations_[dir].fetch_add(1, boost::memory_order_relaxed);
+		migrated_bytes_[dir].fetch_add(bytes, boost::memory_order_relaxed);
+	}
+
+	void
+	lat_stat::collect(std::vector<PoolStat> *pools) const
+	{
+		if(pools->size() < dir_cnt_)
+			pools->resize(dir_cnt_);
+
+		for(unsigned int d=0; d<dir_cnt_; ++d){
+			PoolStat &ps = (*pools)[d];
+			ps.migrations += migrations_[d].load(boost::memory_order_relaxed);
+			ps.migrated_bytes += 
+				migrated_bytes_[d].load(boost::memory_order_relaxed);
+
+			for(unsigned int s=0; s<LAT_STAT_STRIPES; ++s){
+				cell const *c = 
+					cells_[s * dir_cnt_ + d].load(boost::memory_order_acquire);
+				if(0 == c) continue;
+				for(unsigned int i=0; i<STAT_OP_CNT; ++i){
+					hist const &h = c->op[i];
+					LatencyHist &lh = ps.latency[i];
+					for(unsigned int b=0; b<LatencyHist::BUCKETS; ++b)
+						lh.count[b] += h.count[b].load(boost::memory_order_relaxed);
+					lh.total_ns += h.total.load(boost::memory_order_relaxed);
+					boost::uint64_t m = h.max.load(boost::memory_order_relaxed);
+					if(m > lh.max_ns) lh.max_ns = m;
+				}
+			}
+		}
+	}
+
+} // end of namespace BDB
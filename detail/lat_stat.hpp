@@ -0,0 +1,66 @@
+#ifndef _BDB_LAT_STAT_HPP
+#define _BDB_LAT_STAT_HPP
+
+#include "common.hpp"
+#include "boost/atomic.hpp"
+#include "boost/cstdint.hpp"
+
+// Threads are spread over stripes of counters, merged by collect
+#define LAT_STAT_STRIPES 8
+
+namespace BDB {
+
+	/** @brief Latency histograms and migration counters of pools
+	 *  @details Recording threads only add to counters of their own
+	 *  stripe; counters of a stripe and directory are allocated on
+	 *  first use.
+	 */
+	class lat_stat
+	{
+	public:
+		lat_stat();
+		~lat_stat();
+
+		void
+		init(unsigned int dir_cnt);
+
+		/// Add a latency of op on a chunk in dir
+		void
+		record(unsigned int op, unsigned int dir, boost::uint64_t ns);
+
+		/// Count a chunk moved out of dir with bytes copied
+		void
+		migrated(unsigned int dir, size_t bytes);
+
+		/// Add to pools, resized to the directory count if smaller
+		void
+		collect(std::vector<PoolStat> *pools) const;
+
+	private:
+		lat_stat(lat_stat const &cp);
+		lat_stat& operator=(lat_stat const &cp);
+
+		struct hist
+		{
+			boost::atomic<boost::uint64_t> count[LatencyHist::BUCKETS];
+			boost::atomic<boost::uint64_t> total;
+			boost::atomic<boost::uint64_t> max;
+		};
+
+		struct cell
+		{
+			hist op[STAT_OP_CNT];
+		};
+
+		cell*
+		get_cell(unsigned int dir);
+
+		unsigned int dir_cnt_;
+		boost::atomic<cell*> *cells_; // by stripe then directory
+		boost::atomic<boost::uint64_t> *migrations_;
+		boost::atomic<boost::uint64_t> *migrated_bytes_;
+	};
+
+} // end of namespace BDB
+
+#endif // end of header
@@ -0,0 +1,53 @@
+#ifndef _BDB_LOCK_HPP
+#define _BDB_LOCK_HPP
+
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/locks.hpp"
+
+namespace BDB {
+
+	/** @brief Mutex that can be switched off
+	 *  @details A BehaviorDB which is not configured as concurrent
+	 *  keeps all of its mutexes disabled so that single threaded
+	 *  clients pay nothing but a branch for locking.
+	 */
+	struct opt_mutex
+	{
+		opt_mutex()
+		: enabled_(false)
+		{}
+
+		void
+		enable(bool on)
+		{ enabled_ = on; }
+
+		bool
+		enabled() const
+		{ return enabled_; }
+
+		void
+		lock()
+		{ if(enabled_) m_.lock(); }
+
+		bool
+		try_lock()
+		{ return (enabled_) ? m_.try_lock() : true; }
+
+		void
+		unlock()
+		{ if(enabled_) m_.unlock(); }
+
+	private:
+		opt_mutex(opt_mutex const &cp);
+		opt_mutex& operator=(opt_mutex const &cp);
+
+		boost::mutex m_;
+		bool enabled_;
+	};
+
+	typedef boost::lock_guard<opt_mutex> opt_lock_guard;
+	typedef boost::unique_lock<opt_mutex> opt_unique_lock;
+
+} // end of namespace BDB
+
+#endif // end of header
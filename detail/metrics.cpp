@@ -0,0 +1,140 @@
+#include "metrics.hpp"
+#include <cstdio>
+#include <cstdarg>
+
+namespace BDB {
+
+	namespace {
+
+		char const* op_names[STAT_OP_CNT] = {
+			"put", "insert", "update", "get", "del", "stream"
+		};
+
+		char const* error_names[Stat::ERROR_SLOTS] = {
+			"", "ADDRESS_OVERFLOW", "SYSTEM_ERROR", "DATA_TOO_BIG",
+			"POOL_LOCKED", "NON_EXIST", "ROLLBACK_FAILURE", "COMMIT_FAILURE"
+		};
+
+		void
+		append(std::string *out, char const* fmt, ...)
+		{
+			char line[256];
+			va_list ap;
+			va_start(ap, fmt);
+			int len = vsnprintf(line, sizeof(line), fmt, ap);
+			va_end(ap);
+			if(len > 0)
+				out->append(line, ((size_t)len < sizeof(line)) ? len : sizeof(line) - 1);
+		}
+
+		void
+		meta(std::string *out, char const* name, char const* type, 
+			char const* help)
+		{
+			append(out, "# HELP bdb_%s %s\n", name, help);
+			append(out, "# TYPE bdb_%s %s\n", name, type);
+		}
+
+		// one sample per pool directory
+		void
+		pool_metric(std::string *out, Stat const& s, char const* name,
+			char const* type, char const* help,
+			unsigned long long PoolStat::*field)
+		{
+			meta(out, name, type, help);
+			for(size_t d=0; d<s.pools.size(); ++d)
+				append(out, "bdb_%s{dir=\"%04x\"} %llu\n", name, 
+					(unsigned int)d, s.pools[d].*field);
+		}
+
+	} // end of anonymous namespace
+
+	void
+	render_prometheus(Stat const& s, std::string *out)
+	{
+		out->clear();
+
+		meta(out, "gid_memory_bytes", "gauge", "Memory of the global ID table.");
+		append(out, "bdb_gid_memory_bytes %llu\n", s.gid_mem_size);
+		meta(out, "pool_memory_bytes", "gauge", "Memory of pools.");
+		append(out, "bdb_pool_memory_bytes %llu\n", s.pool_mem_size);
+		meta(out, "disk_bytes", "gauge", "Disk space of pool files.");
+		append(out, "bdb_disk_bytes %llu\n", s.disk_size);
+		meta(out, "buffer_memory_bytes", "gauge", 
+			"Migration buffers allocated in the process.");
+		append(out, "bdb_buffer_memory_bytes %llu\n", s.buf_mem_size);
+		meta(out, "buffer_hits_total", "counter", 
+			"Migration buffers borrowed from retained ones.");
+		append(out, "bdb_buffer_hits_total %llu\n", s.buf_hits);
+		meta(out, "buffer_misses_total", "counter", 
+			"Migration buffers allocated.");
+		append(out, "bdb_buffer_misses_total %llu\n", s.buf_misses);
+
+		meta(out, "errors_total", "counter", "Errors by ERRORNUMBER.");
+		for(int i=1; i<Stat::ERROR_SLOTS; ++i)
+			append(out, "bdb_errors_total{code=\"%s\"} %llu\n", 
+				error_names[i], s.errors[i]);
+
+		pool_metric(out, s, "pool_chunk_bytes", "gauge", 
+			"Chunk size of a pool.", &PoolStat::chunk_size);
+		pool_metric(out, s, "pool_chunks", "gauge", 
+			"Chunks in use.", &PoolStat::chunks);
+		pool_metric(out, s, "pool_slots", "gauge", 
+			"Chunk slots up to the last one in use.", &PoolStat::slots);
+		pool_metric(out, s, "pool_data_bytes", "gauge", 
+			"Data in chunks in use.", &PoolStat::data_bytes);
+		pool_metric(out, s, "pool_requested_bytes_total", "counter", 
+			"Data asked to be written.", &PoolStat::bytes_requested);
+		pool_metric(out, s, "pool_written_bytes_total", "counter", 
+			"Data written to the pool file.", &PoolStat::bytes_written);
+		pool_metric(out, s, "pool_migrations_total", "counter", 
+			"Chunks moved out of the pool.", &PoolStat::migrations);
+		pool_metric(out, s, "pool_migrated_bytes_total", "counter", 
+			"Data copied by migrations.", &PoolStat::migrated_bytes);
+
+		meta(out, "op_latency_seconds", "histogram", 
+			"Latency of operations by pool.");
+		for(size_t d=0; d<s.pools.size(); ++d){
+			for(unsigned int i=0; i<STAT_OP_CNT; ++i){
+				LatencyHist const &h = s.pools[d].latency[i];
+				unsigned long long n = h.samples();
+				if(0 == n) continue;
+
+				// buckets end on powers of 2, every 4th one
+				unsigned long long cum(0);
+				for(unsigned int b=0; b<LatencyHist::BUCKETS; ++b){
+					cum += h.count[b];
+					if(3 != b % 4 || b < (METRICS_LE_MIN - 2) * 4 + 3 ||
+						b == LatencyHist::BUCKETS - 1)
+						continue;
+					append(out, "bdb_op_latency_seconds_bucket{dir=\"%04x\","
+						"op=\"%s\",le=\"%.9g\"} %llu\n", (unsigned int)d, 
+						op_names[i], (LatencyHist::upper_bound(b) + 1) / 1e9, cum);
+				}
+				append(out, "bdb_op_latency_seconds_bucket{dir=\"%04x\","
+					"op=\"%s\",le=\"+Inf\"} %llu\n", 
+					(unsigned int)d, op_names[i], n);
+				append(out, "bdb_op_latency_seconds_sum{dir=\"%04x\","
+					"op=\"%s\"} %.9f\n", 
+					(unsigned int)d, op_names[i], h.total_ns / 1e9);
+				append(out, "bdb_op_latency_seconds_count{dir=\"%04x\","
+					"op=\"%s\"} %llu\n", (unsigned int)d, op_names[i], n);
+			}
+		}
+	}
+
+	bool
+	write_prometheus(Stat const& s, char const* fname)
+	{
+		std::string text, tmp(fname);
+		render_prometheus(s, &text);
+		tmp += ".tmp";
+
+		FILE *fp = fopen(tmp.c_str(), "wb");
+		if(0 == fp) return false;
+		bool ok = (text.size() == fwrite(text.data(), 1, text.size(), fp));
+		ok = (0 == fclose(fp)) && ok;
+		return ok && 0 == rename(tmp.c_str(), fname);
+	}
+
+} // end of namespace BDB
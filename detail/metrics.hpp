@@ -0,0 +1,29 @@
+#ifndef _BDB_METRICS_HPP
+#define _BDB_METRICS_HPP
+
+#include "common.hpp"
+#include <string>
+
+// Latencies are exported in buckets of powers of 2 from 2^METRICS_LE_MIN ns
+#define METRICS_LE_MIN 10
+
+namespace BDB {
+
+	/** @brief Render Stat in Prometheus text exposition format
+	 *  @details All metrics are prefixed by bdb_. Sizes are in bytes,
+	 *  latencies in seconds.
+	 */
+	void
+	render_prometheus(Stat const& s, std::string *out);
+
+	/** @brief Render Stat to fname atomically
+	 *  @details Written to fname.tmp and renamed so that readers
+	 *  never see a partial file.
+	 *  @return false if the file can not be written
+	 */
+	bool
+	write_prometheus(Stat const& s, char const* fname);
+
+} // end of namespace BDB
+
+#endif // end of header
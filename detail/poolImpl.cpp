@@ -2,21 +2,73 @@
 #include "poolImpl.hpp"
 #include "idPool.hpp"
 #include "v_iovec.hpp"
+#include "sys_io.hpp"
 #include "boost/variant/apply_visitor.hpp"
+#include "boost/thread/thread.hpp"
 #include <cassert>
 #include <cstdio>
 #include <stdexcept>
+#include <vector>
 
 namespace BDB {
 	
+	namespace {
 
+		// gather segments to pos, SYS_IOV_MAX segments at a time
+		bool
+		write_segs(FILE *fp, Segment const* segs, size_t cnt, off_t pos)
+		{
+			struct iovec iov[SYS_IOV_MAX];
+			while(cnt){
+				int n = (cnt > SYS_IOV_MAX) ? SYS_IOV_MAX : cnt;
+				size_t total(0);
+				for(int i=0; i<n; ++i){
+					iov[i].iov_base = (void*)segs[i].data;
+					iov[i].iov_len = segs[i].size;
+					total += segs[i].size;
+				}
+				if(total != pwritev_full(fp, iov, n, pos))
+					return false;
+				pos += total;
+				segs += n;
+				cnt -= n;
+			}
+			return true;
+		}
+
+		// scatter size bytes from pos to segments
+		bool
+		read_segs(FILE *fp, MutableSegment const* segs, size_t size, off_t pos)
+		{
+			struct iovec iov[SYS_IOV_MAX];
+			while(size){
+				int n(0);
+				size_t total(0);
+				for(; n<SYS_IOV_MAX && total < size; ++n){
+					iov[n].iov_base = segs[n].data;
+					iov[n].iov_len = (segs[n].size > size - total) ? 
+						size - total : segs[n].size;
+					total += iov[n].iov_len;
+				}
+				if(total != preadv_full(fp, iov, n, pos))
+					return false;
+				pos += total;
+				segs += n;
+				size -= total;
+			}
+			return true;
+		}
+
+	} // end of anonymous namespace
 	
 	pool::pool(pool::config const &conf, addr_eval<AddrType>& addrEval)
 	: addrEval(addrEval),
 	  dirID(conf.dirID), 
 	  work_dir(conf.work_dir), trans_dir(conf.trans_dir), 
 	  //addrEval(conf.addrEval), 
-	  file_(0), idPool_(0), headerPool_(conf.dirID, conf.header_dir)
+	  file_(0), idPool_(0), headerPool_(conf.dirID, conf.header_dir),
+	  seq_(0), chunks_(0), data_bytes_(0), 
+	  bytes_requested_(0), bytes_written_(0)
 	{
 		using namespace std;
 
@@ -35,25 +87,26 @@ namespace BDB {
 			}
 		}
         
-        mig_buf_ = new char[MIGBUF_SIZ];
-        file_buf_ = new char[MIGBUF_SIZ];
+        file_buf_ = new char[FILEBUF_SIZ];
         
-		if(0 != setvbuf(file_, file_buf_, _IOFBF, MIGBUF_SIZ))
+		if(0 != setvbuf(file_, file_buf_, _IOFBF, FILEBUF_SIZ))
 			throw runtime_error("pool: setvbuf to pool file failed");
 
 		// setup idPool
 		sprintf(fname, "%s%04x.tran", trans_dir.c_str(), dirID);
 		idPool_ = new IDPool(fname, 0);
+		account_scan();
 
-		
+		mutex_.enable(conf.concurrent);
+		err_mutex_.enable(conf.concurrent);
 	}
 	
 	pool::~pool()
 	{
 		delete idPool_;
-        delete file_buf_;
-        delete mig_buf_;
+		// file_buf_ is used by fclose
 		fclose(file_);
+        delete [] file_buf_;
 	}
 	
 	pool::operator void const*() const
@@ -66,6 +119,7 @@ namespace BDB {
 	AddrType
 	pool::write(char const* data, size_t size)
 	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, -1, size);
 		assert(0 != *this && "pool is not proper initiated");
 		
 
@@ -79,9 +133,10 @@ namespace BDB {
 			return -1;
 		}
 		// allow data = 0 to act as allocation
+		// flush for read_shared since the chunk becomes visible soon
 		if(0 != data && 
-			size != fwrite(data, 1, size, file_) && 
-			0 != fflush(file_))
+			(size != file_write(data, size) || 
+			0 != fflush(file_)))
 		{
 			idPool_->Release(loc_addr);
 			on_error(SYSTEM_ERROR, __LINE__);
@@ -99,14 +154,192 @@ namespace BDB {
 			on_error(COMMIT_FAILURE, __LINE__);
 			return -1;
 		}
+		account_new(size);
+		if(data) account_write(size, size);
 		return loc_addr;
 
 	}
 	
+	size_t
+	pool::write(Segment const* segs, size_t cnt, AddrType *loc_addrs)
+	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, -1, 0);
+		assert(0 != *this && "pool is not proper initiated");
+		
+		static char const zeros[BATCH_PAD_MAX] = {};
+		size_t chunk_size = addrEval.chunk_size_estimation(dirID);
+
+		size_t acquired(0);
+		std::vector<ChunkHeader> headers(cnt);
+		for(; acquired < cnt; ++acquired){
+			if((AddrType)-1 == (loc_addrs[acquired] = idPool_->Acquire()))
+				break;
+			headers[acquired].size = segs[acquired].size;
+		}
+		for(size_t i = acquired; i < cnt; ++i)
+			loc_addrs[i] = -1;
+		if(0 == acquired) return 0;
+		
+		// no stale stdio buffer is left behind pwritev
+		bool failed = (0 != fflush(file_));
+		
+		// runs of adjacent chunks go to one pwritev
+		size_t requested(0), written(0);
+		std::vector<struct iovec> iov;
+		iov.reserve(SYS_IOV_MAX);
+		size_t beg(0);
+		while(!failed && beg < acquired){
+			iov.clear();
+			size_t end = beg;
+			while(end < acquired && iov.size() + 2 <= SYS_IOV_MAX){
+				if(end > beg){
+					size_t pad = chunk_size - segs[end-1].size;
+					if(loc_addrs[end] != loc_addrs[end-1] + 1 || 
+						pad > BATCH_PAD_MAX)
+						break;
+					if(pad){
+						struct iovec z = { (void*)zeros, pad };
+						iov.push_back(z);
+					}
+				}
+				struct iovec d = { (void*)segs[end].data, segs[end].size };
+				iov.push_back(d);
+				++end;
+			}
+			size_t total(0);
+			for(size_t i=0; i<iov.size(); ++i)
+				total += iov[i].iov_len;
+			if(total != pwritev_full(file_, &iov[0], iov.size(), 
+				addr_off2tell(loc_addrs[beg], 0)))
+				failed = true;
+			for(size_t i=beg; i<end; ++i)
+				requested += segs[i].size;
+			written += total;
+			beg = end;
+		}
+		
+		if(!failed && 
+			-1 == headerPool_.write(&headers[0], loc_addrs, acquired))
+			failed = true;
+
+		if(!failed && !idPool_->Commit(loc_addrs, acquired)){
+			on_error(COMMIT_FAILURE, __LINE__);
+			for(size_t i=0; i<acquired; ++i){
+				idPool_->Release(loc_addrs[i]);
+				loc_addrs[i] = -1;
+			}
+			return 0;
+		}
+		
+		if(failed){
+			on_error(SYSTEM_ERROR, __LINE__);
+			for(size_t i=0; i<acquired; ++i){
+				idPool_->Release(loc_addrs[i]);
+				loc_addrs[i] = -1;
+			}
+			return 0;
+		}
+		for(size_t i=0; i<acquired; ++i)
+			account_new(segs[i].size);
+		account_write(requested, written);
+		return acquired;
+	}
+
+	AddrType
+	pool::writev(Segment const* segs, size_t cnt)
+	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, -1, 0);
+		assert(0 != *this && "pool is not proper initiated");
+
+		ChunkHeader header;
+		header.size = 0;
+		for(size_t i=0; i<cnt; ++i)
+			header.size += segs[i].size;
+		
+		assert(header.size <= addrEval.chunk_size_estimation(dirID) && 
+			"data exceeds chunk size");
+
+		AddrType loc_addr = idPool_->Acquire();
+		if((AddrType)-1 == loc_addr)
+			return -1;
+
+		// no stale stdio buffer is left behind pwritev
+		if(0 != fflush(file_) || 
+			!write_segs(file_, segs, cnt, addr_off2tell(loc_addr, 0)))
+		{
+			idPool_->Release(loc_addr);
+			on_error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+
+		if(-1 == headerPool_.write(header, loc_addr)){
+			idPool_->Release(loc_addr);
+			on_error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+
+		if(!idPool_->Commit(loc_addr)){
+			idPool_->Release(loc_addr);
+			on_error(COMMIT_FAILURE, __LINE__);
+			return -1;
+		}
+		account_new(header.size);
+		account_write(header.size, header.size);
+		return loc_addr;
+	}
+
+	AddrType
+	pool::appendv(Segment const* segs, size_t cnt, AddrType addr, 
+		ChunkHeader const* header)
+	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, addr, 0);
+		assert(0 != *this && "pool is not proper initiated");
+		
+		if(!idPool_->isAcquired(addr)){
+			on_error(NON_EXIST, __LINE__);
+			return -1;
+		}
+
+		ChunkHeader loc_header;
+		if(header)
+			loc_header = *header;
+		else if( -1 == headerPool_.read(&loc_header, addr)){
+			on_error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+		
+		size_t off = loc_header.size;
+		for(size_t i=0; i<cnt; ++i)
+			loc_header.size += segs[i].size;
+
+		assert(loc_header.size <= addrEval.chunk_size_estimation(dirID) && 
+			"data exceeds chunk size");
+		
+		modify_guard mg(*this);
+
+		// data beyond the old size are not visible till the header 
+		// is updated, so a failure leaves the chunk as it was
+		if(0 != fflush(file_) || 
+			!write_segs(file_, segs, cnt, addr_off2tell(addr, off)))
+		{
+			on_error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+
+		if(-1 == headerPool_.write(loc_header, addr)){
+			on_error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+		data_bytes_ += loc_header.size - off;
+		account_write(loc_header.size - off, loc_header.size - off);
+		return addr;
+	}
+
 	// off == npos represents an append write
 	AddrType
 	pool::write(char const* data, size_t size, AddrType addr, size_t off, ChunkHeader const* header)
 	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, addr, size);
 		assert(0 != *this && "pool is not proper initiated");
 		
 		// TODO allow now!
@@ -134,11 +367,17 @@ namespace BDB {
 		off = (npos == off) ? loc_header.size : off;
 		
 		// data need to be moved can not larger than move buffer
+		// relocate to another chunk; the source chunk is left to
+		// the caller who may have readers on it
 		size_t moved = loc_header.size - off;
+		if(moved > MIGBUF_SIZ)
+			return merge_copy(data, size, addr, off, this, &loc_header); 
+
 		loc_header.size += size;
 		
-		if(moved > MIGBUF_SIZ)
-			return merge_move(data, size, addr, off, this, &loc_header); 
+		buf_pool::buffer mb;
+		char *mig_buf = mb.get();
+		modify_guard mg(*this);
 
 		if(-1 == seek(addr, off)){
 			on_error(SYSTEM_ERROR, __LINE__);
@@ -146,7 +385,7 @@ namespace BDB {
 		}
 
 		// read data to be moved into mig_buf
-		if(moved && moved != fread(mig_buf_, 1, moved, file_)){
+		if(moved && moved != file_read(mig_buf, moved)){
 			on_error(SYSTEM_ERROR, __LINE__);
 			return -1;
 
@@ -159,7 +398,7 @@ namespace BDB {
 
 		size_t partial(0);
 		// write new data
-		if(size != (partial = fwrite(data, 1, size, file_))){
+		if(size != (partial = file_write(data, size))){
 			if(!partial){ // no data written
 				// abort directly	
 				on_error(SYSTEM_ERROR, __LINE__);
@@ -171,7 +410,7 @@ namespace BDB {
 				on_error(ROLLBACK_FAILURE, __LINE__);
 				return -1;
 			}			
-			if( partial != fwrite(mig_buf_, 1, partial, file_)){
+			if( partial != file_write(mig_buf, partial)){
 				// rollback failed, leave broken data alone
 				on_error(ROLLBACK_FAILURE, __LINE__);
 				return -1;
@@ -179,14 +418,14 @@ namespace BDB {
 		}
 		
 		// write buffered data
-		if(moved && moved != (partial = fwrite(mig_buf_, 1, moved, file_))){
+		if(moved && moved != (partial = file_write(mig_buf, moved))){
 			// rollback to previous state
 			clearerr(file_);
 			if(-1 == seek(addr, off)){
 				on_error(ROLLBACK_FAILURE, __LINE__);
 				return -1;
 			}			
-			if( partial != fwrite(mig_buf_, 1, moved, file_)){
+			if( partial != file_write(mig_buf, moved)){
 				// rollback failed, leave broken data alone
 				on_error(ROLLBACK_FAILURE, __LINE__);
 				return -1;
@@ -205,7 +444,7 @@ namespace BDB {
 				on_error(ROLLBACK_FAILURE, __LINE__);
 				return -1;
 			}			
-			if( partial != fwrite(mig_buf_, 1, moved, file_)){
+			if( partial != file_write(mig_buf, moved)){
 				// rollback failed, leave broken data alone
 				on_error(ROLLBACK_FAILURE, __LINE__);
 				return -1;
@@ -213,7 +452,8 @@ namespace BDB {
 			on_error(SYSTEM_ERROR, __LINE__);
 			return -1;
 		}
-
+		data_bytes_ += size;
+		account_write(size, size + moved);
 
 		return addr;
 	}
@@ -221,6 +461,7 @@ namespace BDB {
 	AddrType
 	pool::write(viov* vv, size_t len)
 	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, -1, len);
 		assert(0 != *this && "pool is not proper initiated");
 
 		size_t total(0);
@@ -249,10 +490,11 @@ namespace BDB {
 			return -1;
 		}
 		
+		buf_pool::buffer mb;
 		write_viov wv;
 		wv.dest = file_;
 		wv.dest_pos = addr_off2tell(loc_addr, 0);
-		wv.buf = mig_buf_;
+		wv.buf = mb.get();
 		wv.bsize = MIGBUF_SIZ;
 		off_t loopOff(0);
 		for(size_t i=0; i<len; ++i){
@@ -278,6 +520,9 @@ namespace BDB {
 			on_error(SYSTEM_ERROR, __LINE__);
 			return -1;
 		}
+		// requested bytes are told by merge_copy
+		account_new(total);
+		account_write(0, total);
 
 		return loc_addr;
 	}
@@ -285,6 +530,7 @@ namespace BDB {
 	AddrType
 	pool::replace(char const *data, size_t size, AddrType addr, ChunkHeader const *header)
 	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, addr, size);
 		assert(0 != *this && "pool is not proper initiated");
 
 		if(!idPool_->isAcquired(addr)){
@@ -303,13 +549,16 @@ namespace BDB {
 		assert(size <= addrEval.chunk_size_estimation(dirID));
 		new_header.size = size;
 		
+		modify_guard mg(*this);
+
 		if(-1 == seek(addr, 0)){
 			on_error(SYSTEM_ERROR, __LINE__);
 			return -1;
 		}
 		
-		if(size != fwrite(data, 1, size, file_) &&
+		if(size != file_write(data, size) ||
 			0 != fflush(file_)){
+			account_free(addr);
 			idPool_->Release(addr);
 			idPool_->Commit(addr);
 			on_error(SYSTEM_ERROR, __LINE__);
@@ -318,11 +567,15 @@ namespace BDB {
 		
 		// update header 
 		if(-1 == headerPool_.write(new_header, addr)){
+			account_free(addr);
 			idPool_->Release(addr);
 			idPool_->Commit(addr);
 			on_error(SYSTEM_ERROR, __LINE__);
 			return -1;
 		}
+		data_bytes_ += size;
+		data_bytes_ -= loc_header.size;
+		account_write(size, size);
 
 		return addr;
 	}
@@ -331,6 +584,7 @@ namespace BDB {
 	size_t
 	pool::read(char* buffer, size_t size, AddrType addr, size_t off, ChunkHeader const* header)
 	{
+		TRACE_SCOPE(TRACE_POOL_READ, dirID, addr, size);
 		assert(0 != *this && "pool is not proper initiated");
 		if(!idPool_->isAcquired(addr)){
 			on_error(NON_EXIST, __LINE__);
@@ -356,7 +610,7 @@ namespace BDB {
 			loc_header.size - off 
 			: size;
 
-		if(toRead != fread(buffer, 1, toRead, file_)){
+		if(toRead != file_read(buffer, toRead)){
 			on_error(SYSTEM_ERROR, __LINE__);
 			return -1;
 		}
@@ -368,24 +622,255 @@ namespace BDB {
 	size_t
 	pool::read(std::string *buffer, size_t max, AddrType addr, size_t off, ChunkHeader const* header)
 	{
+		TRACE_SCOPE(TRACE_POOL_READ, dirID, addr, max);
+		assert(0 != *this && "pool is not proper initiated");
+		if(!buffer) return 0;
+		if(!idPool_->isAcquired(addr)){
+			on_error(NON_EXIST, __LINE__);
+			return -1;
+		}
+
+		// size the buffer once and read into it
+		ChunkHeader loc_header;
+		if(header)
+			loc_header = *header;
+		else if(-1 == headerPool_.read(&loc_header, addr)) {
+			on_error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+		size_t toRead = (off > loc_header.size) ? 0 : loc_header.size - off;
+		if(toRead > max) toRead = max;
+		buffer->resize(toRead);
+		if(0 == toRead) return 0;
+		return read(&(*buffer)[0], toRead, addr, off, &loc_header);
+	}
+	
+	size_t
+	pool::read_shared(char* buffer, size_t size, AddrType addr, size_t off,
+		ChunkHeader const* header)
+	{
+		TRACE_SCOPE(TRACE_POOL_READ, dirID, addr, size);
+		assert(0 != *this && "pool is not proper initiated");
+
+		for(int i=0; i<SEQ_RETRY; ++i){
+			unsigned int seq = seq_.load(boost::memory_order_acquire);
+			if(seq & 1){
+				boost::this_thread::yield();
+				continue;
+			}
+			size_t rt = read_at(buffer, size, addr, off, false, header);
+			boost::atomic_thread_fence(boost::memory_order_acquire);
+			if(seq == seq_.load(boost::memory_order_relaxed) && (size_t)-1 != rt)
+				return rt;
+		}
+		
+		// keep off writers
+		opt_lock_guard lk(mutex_);
+		return read_at(buffer, size, addr, off, true, header);
+	}
+	
+	size_t
+	pool::read_shared(std::string *buffer, size_t max, AddrType addr, size_t off)
+	{
+		TRACE_SCOPE(TRACE_POOL_READ, dirID, addr, max);
 		assert(0 != *this && "pool is not proper initiated");
 		if(!buffer) return 0;
-		if(buffer->size()) buffer->clear();
-		size_t readCnt(0), total(0);
-		while(0 < (readCnt = read(mig_buf_, MIGBUF_SIZ, addr, off))){
-			if(-1 == readCnt) return -1;
-			if(total + readCnt > max) break;
-			buffer->append(mig_buf_, readCnt);
-			off += readCnt;
-			total += readCnt;
+		
+		ChunkHeader header;
+		for(int i=0; i<=SEQ_RETRY; ++i){
+			bool locked = (SEQ_RETRY == i);
+			opt_unique_lock lk(mutex_, boost::defer_lock);
+			if(locked) lk.lock();
+
+			unsigned int seq = seq_.load(boost::memory_order_acquire);
+			if(!locked && (seq & 1)){
+				boost::this_thread::yield();
+				continue;
+			}
+			if(-1 == headerPool_.read_shared(&header, addr)){
+				if(!locked) continue;
+				on_error(SYSTEM_ERROR, __LINE__);
+				return -1;
+			}
+			size_t toRead = (off > header.size) ? 0 : header.size - off;
+			if(toRead > max) toRead = max;
+			
+			buffer->resize(toRead);
+			if(toRead && toRead != pread_full(file_, &(*buffer)[0], 
+				toRead, addr_off2tell(addr, off)))
+			{
+				if(!locked) continue;
+				on_error(SYSTEM_ERROR, __LINE__);
+				return -1;
+			}
+			boost::atomic_thread_fence(boost::memory_order_acquire);
+			if(locked || seq == seq_.load(boost::memory_order_relaxed))
+				return toRead;
 		}
-		return total;
+		return -1; // unreachable
 	}
+
+	size_t
+	pool::read_shared(AddrType const* loc_addrs, size_t cnt, 
+		char* const* buffers, size_t *sizes)
+	{
+		TRACE_SCOPE(TRACE_POOL_READ, dirID, cnt ? loc_addrs[0] : (AddrType)-1, 0);
+		assert(0 != *this && "pool is not proper initiated");
+		if(0 == cnt) return 0;
+
+		std::vector<size_t> caps(sizes, sizes + cnt);
+		std::vector<ChunkHeader> headers(cnt);
+		for(int i=0; i<=SEQ_RETRY; ++i){
+			bool locked = (SEQ_RETRY == i);
+			opt_unique_lock lk(mutex_, boost::defer_lock);
+			if(locked) lk.lock();
+
+			unsigned int seq = seq_.load(boost::memory_order_acquire);
+			if(!locked && (seq & 1)){
+				boost::this_thread::yield();
+				continue;
+			}
+			int err = headerPool_.read_shared(&headers[0], loc_addrs, cnt);
+			if(-1 != err){
+				for(size_t j=0; j<cnt; ++j)
+					sizes[j] = (caps[j] > headers[j].size) ? 
+						headers[j].size : caps[j];
+				err = read_runs(loc_addrs, cnt, buffers, sizes);
+			}
+			if(-1 == err){
+				if(!locked) continue;
+				on_error(SYSTEM_ERROR, __LINE__);
+				return -1;
+			}
+			boost::atomic_thread_fence(boost::memory_order_acquire);
+			if(locked || seq == seq_.load(boost::memory_order_relaxed))
+				return cnt;
+		}
+		return -1; // unreachable
+	}
+
+	size_t
+	pool::read_shared(MutableSegment const* segs, size_t cnt, 
+		AddrType addr, size_t off)
+	{
+		TRACE_SCOPE(TRACE_POOL_READ, dirID, addr, 0);
+		assert(0 != *this && "pool is not proper initiated");
+
+		size_t cap(0);
+		for(size_t i=0; i<cnt; ++i)
+			cap += segs[i].size;
+
+		ChunkHeader header;
+		for(int i=0; i<=SEQ_RETRY; ++i){
+			bool locked = (SEQ_RETRY == i);
+			opt_unique_lock lk(mutex_, boost::defer_lock);
+			if(locked) lk.lock();
+
+			unsigned int seq = seq_.load(boost::memory_order_acquire);
+			if(!locked && (seq & 1)){
+				boost::this_thread::yield();
+				continue;
+			}
+			if(-1 == headerPool_.read_shared(&header, addr)){
+				if(!locked) continue;
+				on_error(SYSTEM_ERROR, __LINE__);
+				return -1;
+			}
+			size_t toRead = (off > header.size) ? 0 : header.size - off;
+			if(toRead > cap) toRead = cap;
+			
+			if(!read_segs(file_, segs, toRead, addr_off2tell(addr, off))){
+				if(!locked) continue;
+				on_error(SYSTEM_ERROR, __LINE__);
+				return -1;
+			}
+			boost::atomic_thread_fence(boost::memory_order_acquire);
+			if(locked || seq == seq_.load(boost::memory_order_relaxed))
+				return toRead;
+		}
+		return -1; // unreachable
+	}
+
+	int
+	pool::read_runs(AddrType const* loc_addrs, size_t cnt, 
+		char* const* buffers, size_t const* sizes)
+	{
+		char gap_buf[BATCH_PAD_MAX];
+		size_t chunk_size = addrEval.chunk_size_estimation(dirID);
+
+		std::vector<struct iovec> iov;
+		iov.reserve(SYS_IOV_MAX);
+		size_t beg(0);
+		while(beg < cnt){
+			iov.clear();
+			size_t end = beg;
+			while(end < cnt && iov.size() + 2 <= SYS_IOV_MAX){
+				if(end > beg){
+					size_t gap = chunk_size - sizes[end-1];
+					if(loc_addrs[end] != loc_addrs[end-1] + 1 || 
+						gap > BATCH_PAD_MAX)
+						break;
+					if(gap){
+						struct iovec g = { gap_buf, gap };
+						iov.push_back(g);
+					}
+				}
+				struct iovec d = { buffers[end], sizes[end] };
+				iov.push_back(d);
+				++end;
+			}
+			size_t total(0);
+			for(size_t i=0; i<iov.size(); ++i)
+				total += iov[i].iov_len;
+			if(total && total != preadv_full(file_, &iov[0], iov.size(), 
+				addr_off2tell(loc_addrs[beg], 0)))
+				return -1;
+			beg = end;
+		}
+		return 0;
+	}
+
+	size_t
+	pool::read_at(char *buffer, size_t size, AddrType addr, size_t off, 
+		bool report, ChunkHeader const* known)
+	{
+		ChunkHeader header;
+		if(known)
+			header = *known;
+		else if(-1 == headerPool_.read_shared(&header, addr)){
+			if(report) on_error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+		if(off > header.size)
+			return 0;
+
+		size_t toRead = (size > header.size - off) ? 
+			header.size - off 
+			: size;
+
+		if(toRead != pread_full(file_, buffer, toRead, addr_off2tell(addr, off))){
+			if(report) on_error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+		return toRead;
+	}
+
+	pool::modify_guard::modify_guard(pool &p)
+	: p(p)
+	{ 
+		p.seq_.fetch_add(1, boost::memory_order_relaxed);
+		boost::atomic_thread_fence(boost::memory_order_release);
+	}
+
+	pool::modify_guard::~modify_guard()
+	{ p.seq_.fetch_add(1, boost::memory_order_release); }
 	
 	AddrType
 	pool::merge_copy(char const* data, size_t size, AddrType src_addr, size_t off, 
 		pool *dest_pool, ChunkHeader const* header)
 	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, src_addr, size);
+		PROFILE_SCOPE(PROF_MIGRATE);
 		assert(0 != *this && "pool is not proper initiated");
 		assert(0 != *dest_pool && "dest pool is not proper initiated");
 
@@ -443,6 +928,47 @@ namespace BDB {
 			on_error(SYSTEM_ERROR, __LINE__);
 			return -1;
 		}
+		if(data) dest_pool->account_write(size, 0);
+		return loc_addr;
+	}
+
+	AddrType
+	pool::merge_copy(Segment const* segs, size_t cnt, AddrType src_addr, 
+		pool *dest_pool, ChunkHeader const* header)
+	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, src_addr, 0);
+		PROFILE_SCOPE(PROF_MIGRATE);
+		assert(0 != *this && "pool is not proper initiated");
+		assert(0 != *dest_pool && "dest pool is not proper initiated");
+
+		ChunkHeader loc_header;
+		if(header)
+			loc_header = *header;
+		else if( -1 == headerPool_.read(&loc_header, src_addr) ){
+			on_error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+
+		std::vector<viov> vv(cnt + 1);
+		file_src fs;
+		fs.fp = file_;
+		fs.off = addr_off2tell(src_addr, 0);
+		vv[0].data = fs;
+		vv[0].size = loc_header.size;
+		for(size_t i=0; i<cnt; ++i){
+			vv[i+1].data = segs[i].data;
+			vv[i+1].size = segs[i].size;
+		}
+		
+		AddrType loc_addr = dest_pool->write(&vv[0], vv.size());
+		if(-1 == loc_addr){
+			on_error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+		size_t requested(0);
+		for(size_t i=0; i<cnt; ++i)
+			requested += segs[i].size;
+		dest_pool->account_write(requested, 0);
 		return loc_addr;
 	}
 
@@ -450,12 +976,15 @@ namespace BDB {
 	pool::merge_move(char const*data, size_t size, AddrType src_addr, size_t off, 
 		pool *dest_pool, ChunkHeader const* header)
 	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, src_addr, size);
+		PROFILE_SCOPE(PROF_MIGRATE);
 		assert(0 != *this && "pool is not proper initiated");
 		assert(0 != *dest_pool && "dest pool is not proper initiated");
 
 		AddrType loc_addr = 
 			merge_copy(data, size, src_addr, off, dest_pool, header);
 
+		account_free(src_addr);
 		idPool_->Release(src_addr);
 		idPool_->Commit(src_addr);
 
@@ -465,9 +994,11 @@ namespace BDB {
 	size_t
 	pool::free(AddrType addr)
 	{ 
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, addr, 0);
 		assert(0 != *this && "pool is not proper initiated");
 
 		if(idPool_->isAcquired(addr)){
+			account_free(addr);
 			idPool_->Release(addr);
 			idPool_->Commit(addr);
 		} else {
@@ -477,9 +1008,39 @@ namespace BDB {
 		return 0;
 	}
 
+	size_t
+	pool::free(AddrType const* addrs, size_t cnt)
+	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, cnt ? addrs[0] : (AddrType)-1, 0);
+		assert(0 != *this && "pool is not proper initiated");
+
+		// released ones are committed in runs between failed ones,
+		// so no list of them is built
+		size_t rt(0), beg(0);
+		for(size_t i=0; i<=cnt; ++i){
+			if(i < cnt && idPool_->isAcquired(addrs[i]) && 
+				0 == idPool_->Release(addrs[i]))
+			{
+				account_free(addrs[i]);
+				continue;
+			}
+			if(i > beg && !idPool_->Commit(addrs + beg, i - beg)){
+				on_error(COMMIT_FAILURE, __LINE__);
+				rt = -1;
+			}
+			if(i < cnt){
+				on_error(NON_EXIST, __LINE__);
+				rt = -1;
+			}
+			beg = i + 1;
+		}
+		return rt;
+	}
+
 	size_t
 	pool::erase(AddrType addr, size_t off, size_t size)
 	{ 
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, addr, size);
 		assert(0 != *this && "pool is not proper initiated");
 
 		if(!idPool_->isAcquired(addr)){
@@ -501,10 +1062,16 @@ namespace BDB {
 		size_t toRead = header.size - size - off;
 		
 		header.size -= size;
+		
+		modify_guard mg(*this);
 
 		headerPool_.write(header, addr);
+		data_bytes_ -= size;
+		account_write(0, toRead);
 		
 		size_t readCnt, loopOff(0);
+		buf_pool::buffer mb;
+		char *mig_buf = mb.get();
 		
 		while(toRead > 0){
 			readCnt = (toRead > MIGBUF_SIZ) ? MIGBUF_SIZ : toRead;
@@ -513,7 +1080,7 @@ namespace BDB {
 				return -1;
 			}
 
-			if(readCnt != fread(mig_buf_, 1, readCnt, file_)){
+			if(readCnt != file_read(mig_buf, readCnt)){
 				on_error(SYSTEM_ERROR, __LINE__);
 				return -1;
 			}
@@ -521,7 +1088,7 @@ namespace BDB {
 				on_error(SYSTEM_ERROR, __LINE__);
 				return -1;
 			}
-			if(readCnt != fwrite(mig_buf_, 1, readCnt, file_) &&
+			if(readCnt != file_write(mig_buf, readCnt) ||
 				0 != fflush(file_))
 			{
 				on_error(SYSTEM_ERROR, __LINE__);
@@ -537,10 +1104,11 @@ namespace BDB {
 	size_t
 	pool::overwrite(char const* data, size_t size, AddrType addr, size_t off)
 	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, addr, size);
 		assert(true == idPool_->isAcquired(addr) && 
 			"overwrite to invalid address");
 
-		assert(off+size < addrEval.chunk_size_estimation(dirID)
+		assert(off+size <= addrEval.chunk_size_estimation(dirID)
 			&& "exceed chunk size");
 
 		if(-1 == seek(addr, off)){
@@ -548,16 +1116,38 @@ namespace BDB {
 			return -1;
 		}
 
-		if(size != fwrite(data, 1, size, file_) &&
+		if(size != file_write(data, size) ||
 			fflush(file_) )
 		{
 			on_error(SYSTEM_ERROR, __LINE__);
 			return -1;
 		}
+		account_write(size, size);
 
 		return size;
 	}
 
+	size_t
+	pool::receive(int in_fd, size_t size, AddrType addr, size_t off)
+	{
+		TRACE_SCOPE(TRACE_POOL_WRITE, dirID, addr, size);
+		assert(true == idPool_->isAcquired(addr) && 
+			"overwrite to invalid address");
+
+		assert(off+size <= addrEval.chunk_size_estimation(dirID)
+			&& "exceed chunk size");
+
+		size_t rt;
+		if(0 != fflush(file_) || 
+			(size_t)-1 == (rt = recv_range(file_, in_fd, addr_off2tell(addr, off), size)))
+		{
+			on_error(SYSTEM_ERROR, __LINE__);
+			return -1;
+		}
+		account_write(rt, rt);
+		return rt;
+	}
+
 	int
 	pool::head(ChunkHeader *header, AddrType addr) const
 	{ 
@@ -575,6 +1165,8 @@ namespace BDB {
 	{
 		assert(0 != *this && "pool is not proper initiated");
 
+		TRACE_SCOPE(TRACE_SEEK, dirID, addr, 0);
+		PROFILE_SCOPE(PROF_DATA);
 		off_t pos = addr;
 		pos *= addrEval.chunk_size_estimation(dirID);
 		pos += off;
@@ -585,6 +1177,22 @@ namespace BDB {
 	}
 
 
+	size_t
+	pool::file_read(char *buffer, size_t size)
+	{
+		TRACE_SCOPE(TRACE_FILE_READ, dirID, -1, size);
+		PROFILE_SCOPE(PROF_DATA);
+		return fread(buffer, 1, size, file_);
+	}
+
+	size_t
+	pool::file_write(char const* data, size_t size)
+	{
+		TRACE_SCOPE(TRACE_FILE_WRITE, dirID, -1, size);
+		PROFILE_SCOPE(PROF_DATA);
+		return fwrite(data, 1, size, file_);
+	}
+
 	off_t
 	pool::addr_off2tell(AddrType addr, size_t off) const
 	{
@@ -601,9 +1209,8 @@ namespace BDB {
 	{
 		assert(0 != *this && "pool is not proper initiated");
 
-		// TODO: lock for mutli proc/thread
-		err_.push_back(std::make_pair<int, int>(errcode, line));	
-		// unlock
+		opt_lock_guard lk(err_mutex_);
+		err_.push_back(std::make_pair(errcode, line));	
 	}
 	
 	std::pair<int, int>
@@ -611,6 +1218,7 @@ namespace BDB {
 	{
 		assert(0 != *this && "pool is not proper initiated");
 
+		opt_lock_guard lk(err_mutex_);
 		std::pair<int, int> rt(0,0);
 		if(!err_.empty()){
 			rt = err_.front();
@@ -620,6 +1228,29 @@ namespace BDB {
 		
 	}
 	
+	void
+	pool::will_need(AddrType addr, size_t off, size_t size) const
+	{ advise_will_need(file_, addr_off2tell(addr, off), size); }
+
+	size_t
+	pool::send(int out_fd, AddrType addr, size_t off, size_t size) const
+	{
+		TRACE_SCOPE(TRACE_POOL_READ, dirID, addr, size);
+#ifndef BDB_POSITIONAL_IO
+		opt_lock_guard lk(mutex_);
+#endif
+		return send_range(file_, out_fd, addr_off2tell(addr, off), size);
+	}
+
+	char const*
+	pool::map(AddrType addr, size_t off, size_t size) const
+	{
+#ifndef BDB_POSITIONAL_IO
+		opt_lock_guard lk(mutex_);
+#endif
+		return map_range(file_, addr_off2tell(addr, off), size);
+	}
+
 	void
 	pool::pine(AddrType addr)
 	{ idPool_->Lock(addr); }
@@ -632,4 +1263,42 @@ namespace BDB {
 	pool::is_pinned(AddrType addr)
 	{ return idPool_->isLocked(addr); }
 
+	bool
+	pool::is_used(AddrType addr) const
+	{ return idPool_->isAcquired(addr); }
+
+	AddrType
+	pool::max_used() const
+	{ return idPool_->max_used(); }
+
+	void
+	pool::account_free(AddrType addr)
+	{
+		ChunkHeader header;
+		--chunks_;
+		if(0 == headerPool_.read_shared(&header, addr))
+			data_bytes_ -= header.size;
+		else
+			on_error(SYSTEM_ERROR, __LINE__);
+	}
+
+	void
+	pool::account_scan()
+	{
+		std::vector<AddrType> addrs;
+		std::vector<ChunkHeader> headers;
+		AddrType end = idPool_->max_used();
+		for(AddrType beg = 0; beg < end; beg += 1024){
+			addrs.clear();
+			for(AddrType a = beg; a < end && a - beg < 1024; ++a)
+				if(idPool_->isAcquired(a)) addrs.push_back(a);
+			if(addrs.empty()) continue;
+			headers.resize(addrs.size());
+			if(-1 == headerPool_.read_shared(&headers[0], &addrs[0], addrs.size()))
+				throw std::runtime_error("pool: read chunk headers failed");
+			for(size_t i=0; i<headers.size(); ++i)
+				account_new(headers[i].size);
+		}
+	}
+
 } // end of BDB namespace
@@ -5,12 +5,31 @@
 #include "addr_eval.hpp"
 #include "fixedPool.hpp"
 #include "chunk.h"
+#include "lock.hpp"
+#include "buf_pool.hpp"
+#include "sys_io.hpp"
+#include "trace_scope.hpp"
+#include "profile_scope.hpp"
+#include "boost/atomic.hpp"
 #include <string>
 #include <cstdlib>
 #include <deque>
 #include <utility>
 
-#define MIGBUF_SIZ 2*1024*1024
+// stdio buffer of a pool file; migration buffers are borrowed from buf_pool
+#define FILEBUF_SIZ (64*1024)
+
+// Optimistic attempts of read_shared before it falls back to locking;
+// without positional I/O reads move the file position and always lock
+#ifdef BDB_POSITIONAL_IO
+#define SEQ_RETRY 16
+#else
+#define SEQ_RETRY 0
+#endif
+
+// Largest unused tail of a chunk that a batch write pads with zeros
+// to keep writing in one run rather than starting another
+#define BATCH_PAD_MAX 4096
 
 
 namespace BDB
@@ -32,11 +51,13 @@ namespace BDB
 			char const* work_dir;
 			char const* trans_dir;
 			char const* header_dir;
+			bool concurrent;
 			//addr_eval<AddrType> * addrEval;
 			
 			config()
 			: dirID(0), 
-			  work_dir(""), trans_dir(""), header_dir("")//,
+			  work_dir(""), trans_dir(""), header_dir(""),
+			  concurrent(false)//,
 			  //addrEval(0)
 			{}
 		};
@@ -61,6 +82,30 @@ namespace BDB
 		AddrType
 		write(viov *vv, size_t len);
 		
+		/** @brief Write a batch of new data
+		 *  @param segs Data, each fits a chunk of this pool
+		 *  @param cnt
+		 *  @param loc_addrs Output addresses, -1 for failed ones
+		 *  @return Number of chunks written
+		 *  @details Chunks are written with vectored I/O, headers are
+		 *  flushed once and one transaction record is committed.
+		 */
+		size_t
+		write(Segment const* segs, size_t cnt, AddrType *loc_addrs);
+		
+		/** @brief Write new data gathered from segments
+		 *  @return Address
+		 */
+		AddrType
+		writev(Segment const* segs, size_t cnt);
+		
+		/** @brief Append data gathered from segments in place
+		 *  @remark The chunk must have room for all segments.
+		 */
+		AddrType
+		appendv(Segment const* segs, size_t cnt, AddrType addr, 
+			ChunkHeader const* header=0);
+		
 		AddrType
 		replace(char const *data, size_t size, AddrType addr, ChunkHeader const *header=0);
 
@@ -70,10 +115,53 @@ namespace BDB
 		size_t
 		read(std::string *buffer, size_t max, AddrType addr, size_t off=0, ChunkHeader const* header=0);
 		
+		/** Read without holding mutex()
+		 *  @remark Callers must guarantee the chunk is not freed 
+		 *  during the call, e.g. by epoch_manager or pine(). 
+		 *  Concurrent in-place modifications are detected and 
+		 *  the read is retried. A header known by the caller 
+		 *  saves reading it.
+		 */
+		size_t
+		read_shared(char* buffer, size_t size, AddrType addr, size_t off=0, 
+			ChunkHeader const* header=0);
+		
+		size_t
+		read_shared(std::string *buffer, size_t max, AddrType addr, size_t off=0);
+		
+		/** Read a batch of chunks without holding mutex()
+		 *  @param loc_addrs Addresses in ascending order
+		 *  @param cnt
+		 *  @param buffers Output buffer of each chunk
+		 *  @param sizes Size of each buffer as input, 
+		 *  size of data read as output
+		 *  @return cnt or -1 for failure
+		 *  @details Headers of consecutive chunks are read together. 
+		 *  Adjacent chunks whose gap is small are read by one preadv
+		 *  with the gaps discarded.
+		 *  @remark Same requirement as read_shared above.
+		 */
+		size_t
+		read_shared(AddrType const* loc_addrs, size_t cnt, 
+			char* const* buffers, size_t *sizes);
+		
+		/** Scatter data from off to segments without holding mutex()
+		 *  @return Size of data read or -1 for failure
+		 *  @remark Same requirement as read_shared above.
+		 */
+		size_t
+		read_shared(MutableSegment const* segs, size_t cnt, 
+			AddrType addr, size_t off=0);
+		
 		AddrType
 		merge_copy(char const* data, size_t size, AddrType src_addr, 
 			size_t off, pool* dest_pool, ChunkHeader const* header=0);
 
+		// append segments to a copy of src_addr placed in dest_pool
+		AddrType
+		merge_copy(Segment const* segs, size_t cnt, AddrType src_addr, 
+			pool* dest_pool, ChunkHeader const* header=0);
+
 		AddrType
 		merge_move(char const* data, size_t size, AddrType src_addr, 
 			size_t off, pool *dest_pool, ChunkHeader const* header=0);
@@ -81,6 +169,13 @@ namespace BDB
 		size_t
 		free(AddrType addr);
 
+		/** @brief Free many chunks with one transaction write
+		 *  @param addrs Ascending addresses commit more compactly.
+		 *  @return 0 or -1 if any of them failed
+		 */
+		size_t
+		free(AddrType const* addrs, size_t cnt);
+
 		size_t
 		erase(AddrType addr, size_t off, size_t size);
 	
@@ -107,6 +202,15 @@ namespace BDB
 		size_t
 		overwrite(char const* data, size_t size, AddrType addr, size_t off);
 
+		/** Overwrite chunk data with size bytes read from in_fd
+		 *  @return Bytes written, less than size if in_fd ends 
+		 *  early, or -1 for failure
+		 *  @remark Same restriction as overwrite.
+		 *  @see recv_range
+		 */
+		size_t
+		receive(int in_fd, size_t size, AddrType addr, size_t off);
+
 		// misc 
 
 		int
@@ -118,6 +222,28 @@ namespace BDB
 		std::pair<int, int>
 		get_error();
 
+		/// Hint the OS to read [off, off+size) of a chunk ahead
+		void
+		will_need(AddrType addr, size_t off, size_t size) const;
+
+		/** Send [off, off+size) of a chunk to a descriptor
+		 *  @return Bytes sent or -1 for failure
+		 *  @remark The chunk must be pinned during the call. Without
+		 *  BDB_POSITIONAL_IO mutex() is held meanwhile.
+		 *  @see send_range
+		 */
+		size_t
+		send(int out_fd, AddrType addr, size_t off, size_t size) const;
+
+		/** Map [off, off+size) of a chunk read-only
+		 *  @return Mapped data or 0 for failure
+		 *  @remark The chunk must be pinned while mapped. Without
+		 *  BDB_POSITIONAL_IO it is copied under mutex().
+		 *  @see unmap_range
+		 */
+		char const*
+		map(AddrType addr, size_t off, size_t size) const;
+
 		void
 		pine(AddrType addr);
 
@@ -127,17 +253,80 @@ namespace BDB
 		bool
 		is_pinned(AddrType addr);
 
+		bool
+		is_used(AddrType addr) const;
+
+		/// One past the largest address ever used
+		AddrType
+		max_used() const;
+
+		/** Lock that guards the pool file, the migration buffer,
+		 *  headers and chunk IDs of this pool. Callers lock it 
+		 *  around every method call except on_error/get_error.
+		 *  Multiple pools must be locked in ascending order of dirID.
+		 */
+		opt_mutex&
+		mutex() const
+		{ return mutex_; }
+
+		/// Changes whenever a visible chunk is modified in place
+		unsigned int
+		modify_seq() const
+		{ return seq_.load(boost::memory_order_acquire); }
+
 		/* TODO: To be considered
 		std::pair<AddrType, size_t>
 		tell2addr_off(off_t fpos) const;
 		*/
 		
 	private:
+		// Marks in-place modification of a visible chunk 
+		// for read_shared
+		struct modify_guard
+		{
+			modify_guard(pool &p);
+			~modify_guard();
+			pool &p;
+		};
+		
+		size_t
+		read_at(char *buffer, size_t size, AddrType addr, size_t off, 
+			bool report, ChunkHeader const* header);
+
+		// read data of sizes[i] bytes of each chunk, no header involved
+		int
+		read_runs(AddrType const* loc_addrs, size_t cnt, 
+			char* const* buffers, size_t const* sizes);
+
 		off_t
 		seek(AddrType addr, size_t off =0);
 
+		// fread and fwrite of chunk data at the position of file_
+		size_t
+		file_read(char *buffer, size_t size);
+
+		size_t
+		file_write(char const* data, size_t size);
+
 		off_t
 		addr_off2tell(AddrType addr, size_t off) const;
+
+		// space accounting of a new chunk, a chunk to be freed and
+		// bytes written for requested ones; mutex() is held
+		void
+		account_new(size_t size)
+		{ ++chunks_; data_bytes_ += size; }
+
+		void
+		account_free(AddrType addr);
+
+		void
+		account_write(size_t requested, size_t written)
+		{ bytes_requested_ += requested; bytes_written_ += written; }
+
+		// count live chunks and their data at startup
+		void
+		account_scan();
 		
 		/*
 		void lock_acq();
@@ -155,13 +344,24 @@ namespace BDB
 		
 		// pool file
 		FILE *file_;
-		char *mig_buf_;
 		char *file_buf_;
 		// id file
 		IDPool *idPool_;
 
 		// header
 		fixed_pool<ChunkHeader, 8> headerPool_;
+		
+		mutable opt_mutex mutex_;
+		opt_mutex err_mutex_;
+		
+		// odd while a visible chunk is modified in place
+		boost::atomic<unsigned int> seq_;
+
+		// space accounting, see PoolStat
+		size_t chunks_;
+		unsigned long long data_bytes_;
+		unsigned long long bytes_requested_;
+		unsigned long long bytes_written_;
 	public:	
 		std::deque<std::pair<int,int> > err_;
 	};
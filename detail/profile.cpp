@@ -0,0 +1,105 @@
+#include "profile_scope.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/tss.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace BDB {
+
+	namespace {
+
+		// counters of live threads and the sum of exited ones
+		boost::mutex threads_mutex;
+		std::vector<prof_thread*> threads;
+		boost::uint64_t exited_self[PROF_STAGE_CNT];
+		boost::uint64_t exited_count[PROF_STAGE_CNT];
+
+		void
+		retire_thread(prof_thread *t)
+		{
+			boost::mutex::scoped_lock lock(threads_mutex);
+			for(unsigned int i=0; i<PROF_STAGE_CNT; ++i){
+				exited_self[i] += t->self[i].load(boost::memory_order_relaxed);
+				exited_count[i] += t->count[i].load(boost::memory_order_relaxed);
+			}
+			threads.erase(std::find(threads.begin(), threads.end(), t));
+			delete t;
+		}
+
+		boost::thread_specific_ptr<prof_thread> this_prof_thread(&retire_thread);
+
+#ifdef BDB_PROFILE
+		char const* stage_names[PROF_STAGE_CNT] = {
+			"op", "addr", "header", "data", "migrate", "commit", "log"
+		};
+#endif
+
+	} // end of anonymous namespace
+
+	prof_thread&
+	prof_thread::current()
+	{
+		prof_thread *t = this_prof_thread.get();
+		if(0 == t){
+			t = new prof_thread;
+			for(unsigned int i=0; i<PROF_STAGE_CNT; ++i){
+				t->self[i].store(0, boost::memory_order_relaxed);
+				t->count[i].store(0, boost::memory_order_relaxed);
+			}
+			t->cur = PROF_STAGE_CNT;
+			t->last = 0;
+			boost::mutex::scoped_lock lock(threads_mutex);
+			threads.push_back(t);
+			this_prof_thread.reset(t);
+		}
+		return *t;
+	}
+
+	bool
+	profile_dump(FILE *fp)
+	{
+#ifdef BDB_PROFILE
+		boost::uint64_t self[PROF_STAGE_CNT], count[PROF_STAGE_CNT];
+		{
+			boost::mutex::scoped_lock lock(threads_mutex);
+			for(unsigned int i=0; i<PROF_STAGE_CNT; ++i){
+				self[i] = exited_self[i];
+				count[i] = exited_count[i];
+				for(size_t j=0; j<threads.size(); ++j){
+					self[i] += threads[j]->self[i].load(boost::memory_order_relaxed);
+					count[i] += threads[j]->count[i].load(boost::memory_order_relaxed);
+				}
+			}
+		}
+		boost::uint64_t sum(0);
+		for(unsigned int i=0; i<PROF_STAGE_CNT; ++i)
+			sum += self[i];
+
+		fprintf(fp, "%-8s %12s %16s %12s %7s\n", "stage", "count",
+			PROFILE_UNIT, "per count", "share");
+		for(unsigned int i=0; i<PROF_STAGE_CNT; ++i)
+			fprintf(fp, "%-8s %12llu %16llu %12.1f %6.2f%%\n", stage_names[i],
+				(unsigned long long)count[i], (unsigned long long)self[i],
+				count[i] ? (double)self[i] / count[i] : 0.0,
+				sum ? 100.0 * self[i] / sum : 0.0);
+		return true;
+#else
+		(void)fp;
+		return false;
+#endif
+	}
+
+	void
+	profile_reset()
+	{
+		boost::mutex::scoped_lock lock(threads_mutex);
+		for(unsigned int i=0; i<PROF_STAGE_CNT; ++i){
+			exited_self[i] = exited_count[i] = 0;
+			for(size_t j=0; j<threads.size(); ++j){
+				threads[j]->self[i].store(0, boost::memory_order_relaxed);
+				threads[j]->count[i].store(0, boost::memory_order_relaxed);
+			}
+		}
+	}
+
+} // end of namespace BDB
@@ -0,0 +1,103 @@
+#ifndef _BDB_PROFILE_SCOPE_HPP
+#define _BDB_PROFILE_SCOPE_HPP
+
+#include "profile.hpp"
+#include "boost/atomic.hpp"
+#include "boost/cstdint.hpp"
+#include <time.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define PROFILE_UNIT "cycles"
+#else
+#define PROFILE_UNIT "ns"
+#endif
+
+// Profiling points; they expand to nothing unless BDB_PROFILE is
+// defined. A stage lasts to the end of the enclosing block.
+#ifdef BDB_PROFILE
+#define PROFILE_CAT2_(a, b) a##b
+#define PROFILE_CAT_(a, b) PROFILE_CAT2_(a, b)
+#define PROFILE_SCOPE(stage) \
+	BDB::prof_scope PROFILE_CAT_(prof_scope_, __LINE__)(stage)
+#else
+#define PROFILE_SCOPE(stage)
+#endif
+
+namespace BDB {
+
+	enum prof_stage {
+		PROF_OP = 0, PROF_ADDR, PROF_HEADER, PROF_DATA, PROF_MIGRATE,
+		PROF_COMMIT, PROF_LOG,
+		PROF_STAGE_CNT
+	};
+
+	inline boost::uint64_t
+	prof_tick()
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		return __rdtsc();
+#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (boost::uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+	}
+
+	/** @brief Counters of a thread
+	 *  @details Only the owner thread adds to them, so a load and a
+	 *  store take the place of an atomic add; profile_dump reads
+	 *  them from other threads.
+	 */
+	struct prof_thread
+	{
+		boost::atomic<boost::uint64_t> self[PROF_STAGE_CNT];
+		boost::atomic<boost::uint64_t> count[PROF_STAGE_CNT];
+		unsigned int cur;     // innermost stage, PROF_STAGE_CNT for none
+		boost::uint64_t last; // tick since when cur is charged
+
+		/// Counters of the calling thread
+		static prof_thread&
+		current();
+
+		void
+		add(boost::atomic<boost::uint64_t> &c, boost::uint64_t n)
+		{
+			c.store(c.load(boost::memory_order_relaxed) + n,
+				boost::memory_order_relaxed);
+		}
+	};
+
+	/// Charge time to a stage and suspend the enclosing one meanwhile
+	class prof_scope
+	{
+	public:
+		explicit prof_scope(unsigned int stage)
+		: t_(prof_thread::current()), outer_(t_.cur)
+		{
+			boost::uint64_t now = prof_tick();
+			if(PROF_STAGE_CNT != outer_)
+				t_.add(t_.self[outer_], now - t_.last);
+			t_.add(t_.count[stage], 1);
+			t_.cur = stage;
+			t_.last = now;
+		}
+
+		~prof_scope()
+		{
+			boost::uint64_t now = prof_tick();
+			t_.add(t_.self[t_.cur], now - t_.last);
+			t_.cur = outer_;
+			t_.last = now;
+		}
+
+	private:
+		prof_scope(prof_scope const &cp);
+		prof_scope& operator=(prof_scope const &cp);
+
+		prof_thread &t_;
+		unsigned int outer_;
+	};
+
+} // end of namespace BDB
+
+#endif // end of header
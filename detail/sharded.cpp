@@ -0,0 +1,782 @@
+#include "sharded.hpp"
+#include "bdb.hpp"
+#include "lock.hpp"
+#include "metrics.hpp"
+#include "boost/unordered_map.hpp"
+#include "boost/atomic.hpp"
+#include "boost/thread/thread.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/function.hpp"
+#include "boost/exception_ptr.hpp"
+#include <deque>
+#include <vector>
+#include <stdexcept>
+
+// Largest max of get_batch served by BehaviorDB::get_batch, outputs are
+// sized to max beforehand. Larger ones are read one by one.
+#define SHARD_GET_BATCH_MAX (1024*1024)
+
+namespace BDB {
+
+	struct ShardedImpl
+	{
+		typedef boost::unordered_map<stream_state const*, unsigned int> StateCont;
+		typedef std::vector<size_t> Bucket;
+		typedef void (*RunFunc)(ShardedImpl*, unsigned int, Bucket const*, void*);
+
+		// a thread kept for each shard to serve its buckets
+		struct worker
+		{
+			worker(): stop(false) {}
+
+			boost::thread thr;
+			boost::mutex mutex;
+			boost::condition_variable cond;
+			std::deque<boost::function<void()> > queue;
+			bool stop;
+		};
+
+		// buckets of a batch call not served yet
+		struct pending
+		{
+			explicit pending(unsigned int cnt): left(cnt) {}
+
+			void
+			done();
+
+			// keep the first exception of a bucket for the caller
+			void
+			fail(boost::exception_ptr const &e);
+
+			void
+			wait();
+
+			boost::mutex mutex;
+			boost::condition_variable cond;
+			unsigned int left;
+			boost::exception_ptr error;
+		};
+
+		struct bucket_job
+		{
+			ShardedImpl *impl;
+			RunFunc run;
+			unsigned int s;
+			Bucket const *b;
+			void *arg;
+			pending *p;
+
+			void
+			operator()() const
+			{
+				// exceptions must not leave a worker thread
+				try{
+					(*run)(impl, s, b, arg);
+				}catch(...){
+					p->fail(boost::current_exception());
+				}
+				p->done();
+			}
+		};
+
+		ShardedImpl(Config const &conf,
+			char const* const* root_dirs, unsigned int shard_cnt);
+
+		~ShardedImpl();
+
+		unsigned int
+		shard_of(AddrType addr) const;
+
+		// next shard for new data
+		unsigned int
+		next_shard();
+
+		// shard of a state or -1
+		unsigned int
+		shard_of(stream_state const* state);
+
+		void
+		track(stream_state const* state, unsigned int s);
+
+		void
+		untrack(stream_state const* state);
+
+		// group indices of a batch by shard
+		template<typename Route>
+		void
+		dispatch(size_t cnt, Route route, RunFunc run, void *arg);
+
+		void
+		serve(worker *w);
+
+		void
+		stop_workers();
+
+		AddrType beg, end, span;
+		std::vector<BehaviorDB*> shards;
+		std::vector<worker*> workers; // none for a single shard
+		boost::atomic<unsigned int> rr;
+
+		opt_mutex mutex; // states
+		StateCont states;
+	};
+
+	ShardedImpl::ShardedImpl(Config const &conf,
+		char const* const* root_dirs, unsigned int shard_cnt)
+	: beg(conf.beg), end(conf.end), span(0), rr(0)
+	{
+		if(0 == shard_cnt || conf.end - conf.beg < shard_cnt)
+			throw std::invalid_argument(
+				"ShardedBehaviorDB: shard_cnt should be in [1, end - beg]");
+
+		span = (conf.end - conf.beg) / shard_cnt +
+			((conf.end - conf.beg) % shard_cnt ? 1 : 0);
+
+		mutex.enable(conf.concurrent);
+
+		try{
+			for(unsigned int i=0; i<shard_cnt; ++i){
+				Config sc(conf);
+				sc.beg = conf.beg + i * span;
+				sc.end = (conf.end - sc.beg > span) ? sc.beg + span : conf.end;
+				sc.root_dir = root_dirs[i];
+				sc.pool_dir = sc.trans_dir = sc.header_dir = "";
+				if(sc.log_dir) sc.log_dir = "";
+				sc.validate();
+				shards.push_back(new BehaviorDB(sc));
+			}
+			for(unsigned int i=0; 1 < shard_cnt && i<shard_cnt; ++i){
+				workers.push_back(new worker);
+				workers.back()->thr =
+					boost::thread(&ShardedImpl::serve, this, workers.back());
+			}
+		}catch(...){
+			stop_workers();
+			for(size_t i=0; i<shards.size(); ++i)
+				delete shards[i];
+			throw;
+		}
+	}
+
+	ShardedImpl::~ShardedImpl()
+	{
+		stop_workers();
+		for(size_t i=0; i<shards.size(); ++i)
+			delete shards[i];
+	}
+
+	void
+	ShardedImpl::stop_workers()
+	{
+		for(size_t i=0; i<workers.size(); ++i){
+			{
+				boost::lock_guard<boost::mutex> lk(workers[i]->mutex);
+				workers[i]->stop = true;
+			}
+			workers[i]->cond.notify_one();
+		}
+		for(size_t i=0; i<workers.size(); ++i){
+			if(workers[i]->thr.joinable())
+				workers[i]->thr.join();
+			delete workers[i];
+		}
+		workers.clear();
+	}
+
+	void
+	ShardedImpl::serve(worker *w)
+	{
+		boost::function<void()> job;
+		while(true){
+			{
+				boost::unique_lock<boost::mutex> lk(w->mutex);
+				while(w->queue.empty() && !w->stop)
+					w->cond.wait(lk);
+				if(w->queue.empty()) return;
+				job.swap(w->queue.front());
+				w->queue.pop_front();
+			}
+			job();
+		}
+	}
+
+	void
+	ShardedImpl::pending::done()
+	{
+		boost::lock_guard<boost::mutex> lk(mutex);
+		if(0 == --left) cond.notify_one();
+	}
+
+	void
+	ShardedImpl::pending::fail(boost::exception_ptr const &e)
+	{
+		boost::lock_guard<boost::mutex> lk(mutex);
+		if(!error) error = e;
+	}
+
+	void
+	ShardedImpl::pending::wait()
+	{
+		boost::unique_lock<boost::mutex> lk(mutex);
+		while(left) cond.wait(lk);
+	}
+
+	unsigned int
+	ShardedImpl::shard_of(AddrType addr) const
+	{
+		if(addr < beg || addr >= end)
+			return -1;
+		return (addr - beg) / span;
+	}
+
+	unsigned int
+	ShardedImpl::next_shard()
+	{ return rr.fetch_add(1, boost::memory_order_relaxed) % shards.size(); }
+
+	unsigned int
+	ShardedImpl::shard_of(stream_state const* state)
+	{
+		opt_lock_guard lk(mutex);
+		StateCont::iterator iter = states.find(state);
+		return (states.end() == iter) ? -1 : iter->second;
+	}
+
+	void
+	ShardedImpl::track(stream_state const* state, unsigned int s)
+	{
+		if(0 == state) return;
+		opt_lock_guard lk(mutex);
+		states[state] = s;
+	}
+
+	void
+	ShardedImpl::untrack(stream_state const* state)
+	{
+		opt_lock_guard lk(mutex);
+		states.erase(state);
+	}
+
+	template<typename Route>
+	void
+	ShardedImpl::dispatch(size_t cnt, Route route, RunFunc run, void *arg)
+	{
+		std::vector<Bucket> buckets(shards.size());
+		for(size_t i=0; i<cnt; ++i){
+			unsigned int s = route(i);
+			if(-1 != (int)s) buckets[s].push_back(i);
+		}
+
+		// the calling thread serves the last non-empty bucket and 
+		// shard workers the others, so one shard involves no handoff
+		std::vector<unsigned int> used;
+		for(unsigned int s=0; s<buckets.size(); ++s)
+			if(!buckets[s].empty()) used.push_back(s);
+		if(used.empty()) return;
+
+		pending p(used.size() - 1);
+		for(size_t i=0; i+1 < used.size(); ++i){
+			unsigned int s = used[i];
+			bucket_job job = { this, run, s, &buckets[s], arg, &p };
+			{
+				boost::lock_guard<boost::mutex> lk(workers[s]->mutex);
+				workers[s]->queue.push_back(job);
+			}
+			workers[s]->cond.notify_one();
+		}
+		try{
+			(*run)(this, used.back(), &buckets[used.back()], arg);
+		}catch(...){
+			p.wait(); // workers still use buckets
+			throw;
+		}
+		p.wait();
+		if(p.error)
+			boost::rethrow_exception(p.error);
+	}
+
+	// ---- batch workers ----
+
+	namespace {
+
+		struct put_arg
+		{
+			Segment const* segs;
+			AddrType *addrs;
+		};
+
+		struct get_arg
+		{
+			std::string *outputs;
+			size_t max;
+			AddrType const* addrs;
+			std::vector<char> *done;
+		};
+
+		struct del_arg
+		{
+			AddrType const* addrs;
+			std::vector<size_t> *deleted; // per shard
+		};
+
+		struct append_arg
+		{
+			WriteVector const* wvs;
+			std::vector<size_t> *appended; // per shard
+		};
+
+		struct route_rr
+		{
+			ShardedImpl *impl;
+			unsigned int
+			operator()(size_t) const
+			{ return impl->next_shard(); }
+		};
+
+		struct route_wv
+		{
+			ShardedImpl *impl;
+			WriteVector const* wvs;
+			unsigned int
+			operator()(size_t i) const
+			{ return impl->shard_of(*wvs[i].address); }
+		};
+
+		struct route_addr
+		{
+			ShardedImpl *impl;
+			AddrType const* addrs;
+			unsigned int
+			operator()(size_t i) const
+			{ return impl->shard_of(addrs[i]); }
+		};
+
+		void
+		put_run(ShardedImpl *impl, unsigned int s,
+			ShardedImpl::Bucket const *b, void *arg)
+		{
+			put_arg *a = static_cast<put_arg*>(arg);
+			std::vector<Segment> segs(b->size());
+			std::vector<AddrType> addrs(b->size());
+			for(size_t i=0; i<b->size(); ++i)
+				segs[i] = a->segs[(*b)[i]];
+			impl->shards[s]->put_batch(&segs[0], segs.size(), &addrs[0]);
+			for(size_t i=0; i<b->size(); ++i)
+				a->addrs[(*b)[i]] = addrs[i];
+		}
+
+		void
+		get_run(ShardedImpl *impl, unsigned int s,
+			ShardedImpl::Bucket const *b, void *arg)
+		{
+			get_arg *a = static_cast<get_arg*>(arg);
+			size_t n = b->size();
+			if(a->max > SHARD_GET_BATCH_MAX){
+				for(size_t i=0; i<n; ++i){
+					size_t idx = (*b)[i];
+					a->outputs[idx].clear();
+					(*a->done)[idx] =
+						0 != impl->shards[s]->get(
+							&a->outputs[idx], a->max, a->addrs[idx]);
+				}
+				return;
+			}
+
+			std::vector<AddrType> addrs(n);
+			std::vector<char*> bufs(n, (char*)0);
+			std::vector<size_t> sizes(n, a->max);
+			for(size_t i=0; i<n; ++i){
+				size_t idx = (*b)[i];
+				addrs[i] = a->addrs[idx];
+				a->outputs[idx].resize(a->max);
+				if(a->max) bufs[i] = &a->outputs[idx][0];
+			}
+			impl->shards[s]->get_batch(&addrs[0], n, &bufs[0], &sizes[0]);
+			for(size_t i=0; i<n; ++i){
+				size_t idx = (*b)[i];
+				a->outputs[idx].resize(sizes[i]);
+				(*a->done)[idx] = 0 != sizes[i];
+			}
+		}
+
+		void
+		del_run(ShardedImpl *impl, unsigned int s,
+			ShardedImpl::Bucket const *b, void *arg)
+		{
+			del_arg *a = static_cast<del_arg*>(arg);
+			size_t n = b->size();
+			std::vector<AddrType> addrs(n);
+			for(size_t i=0; i<n; ++i)
+				addrs[i] = a->addrs[(*b)[i]];
+			(*a->deleted)[s] = impl->shards[s]->del_batch(&addrs[0], n);
+		}
+
+		void
+		append_run(ShardedImpl *impl, unsigned int s,
+			ShardedImpl::Bucket const *b, void *arg)
+		{
+			append_arg *a = static_cast<append_arg*>(arg);
+			size_t n = b->size();
+			// addresses are still written back through wvs
+			std::vector<WriteVector> wvs(n);
+			for(size_t i=0; i<n; ++i)
+				wvs[i] = a->wvs[(*b)[i]];
+			(*a->appended)[s] = impl->shards[s]->append(&wvs[0], n);
+		}
+	} // end of anonymous namespace
+
+	// ---- ShardedBehaviorDB ----
+
+	ShardedBehaviorDB::ShardedBehaviorDB(Config const &conf,
+		char const* const* root_dirs, unsigned int shard_cnt)
+	: impl_(new ShardedImpl(conf, root_dirs, shard_cnt))
+	{}
+
+	ShardedBehaviorDB::~ShardedBehaviorDB()
+	{ delete impl_; }
+
+	AddrType
+	ShardedBehaviorDB::put(char const *data, size_t size)
+	{
+		// skip shards that are full
+		AddrType rt(-1);
+		unsigned int s = impl_->next_shard();
+		for(size_t i=0; i<impl_->shards.size() && (AddrType)-1 == rt; ++i)
+			rt = impl_->shards[(s + i) % impl_->shards.size()]->put(data, size);
+		return rt;
+	}
+
+	AddrType
+	ShardedBehaviorDB::putv(Segment const* segs, size_t cnt)
+	{
+		AddrType rt(-1);
+		unsigned int s = impl_->next_shard();
+		for(size_t i=0; i<impl_->shards.size() && (AddrType)-1 == rt; ++i)
+			rt = impl_->shards[(s + i) % impl_->shards.size()]->putv(segs, cnt);
+		return rt;
+	}
+
+	AddrType
+	ShardedBehaviorDB::appendv(Segment const* segs, size_t cnt, AddrType addr)
+	{
+		unsigned int s = impl_->shard_of(addr);
+		if(-1 == (int)s) return -1;
+		return impl_->shards[s]->appendv(segs, cnt, addr);
+	}
+
+	size_t
+	ShardedBehaviorDB::append(WriteVector const* wvs, size_t cnt)
+	{
+		std::vector<size_t> appended(impl_->shards.size(), 0);
+		append_arg a = { wvs, &appended };
+		route_wv r = { impl_, wvs };
+		impl_->dispatch(cnt, r, &append_run, &a);
+
+		// those out of range are not routed
+		for(size_t i=0; i<cnt; ++i)
+			if(-1 == (int)impl_->shard_of(*wvs[i].address))
+				*wvs[i].address = -1;
+
+		size_t rt(0);
+		for(size_t i=0; i<appended.size(); ++i)
+			rt += appended[i];
+		return rt;
+	}
+
+	AddrType
+	ShardedBehaviorDB::put_from_fd(int fd, size_t size)
+	{
+		// fd can not be read again, so no other shard is tried
+		unsigned int s = impl_->next_shard();
+		return impl_->shards[s]->put_from_fd(fd, size);
+	}
+
+	AddrType
+	ShardedBehaviorDB::put(char const *data, size_t size, AddrType addr, size_t off)
+	{
+		unsigned int s = impl_->shard_of(addr);
+		if(-1 == (int)s) return -1;
+		return impl_->shards[s]->put(data, size, addr, off);
+	}
+
+	AddrType
+	ShardedBehaviorDB::put(std::string const& data)
+	{ return put(data.data(), data.size()); }
+
+	AddrType
+	ShardedBehaviorDB::put(std::string const& data, AddrType addr, size_t off)
+	{ return put(data.data(), data.size(), addr, off); }
+
+	AddrType
+	ShardedBehaviorDB::update(char const* data, size_t size, AddrType addr)
+	{
+		unsigned int s = impl_->shard_of(addr);
+		if(-1 == (int)s) return -1;
+		return impl_->shards[s]->update(data, size, addr);
+	}
+
+	AddrType
+	ShardedBehaviorDB::update(std::string const& data, AddrType addr)
+	{ return update(data.data(), data.size(), addr); }
+
+	size_t
+	ShardedBehaviorDB::get(char *output, size_t size, AddrType addr, size_t off)
+	{
+		unsigned int s = impl_->shard_of(addr);
+		if(-1 == (int)s) return 0;
+		return impl_->shards[s]->get(output, size, addr, off);
+	}
+
+	size_t
+	ShardedBehaviorDB::get(std::string *output, size_t max, AddrType addr, size_t off)
+	{
+		unsigned int s = impl_->shard_of(addr);
+		if(-1 == (int)s) return 0;
+		return impl_->shards[s]->get(output, max, addr, off);
+	}
+
+	size_t
+	ShardedBehaviorDB::getv(MutableSegment const* segs, size_t cnt, 
+		AddrType addr, size_t off)
+	{
+		unsigned int s = impl_->shard_of(addr);
+		if(-1 == (int)s) return 0;
+		return impl_->shards[s]->getv(segs, cnt, addr, off);
+	}
+
+	size_t
+	ShardedBehaviorDB::send_to_fd(AddrType addr, int fd, size_t off, size_t size)
+	{
+		unsigned int s = impl_->shard_of(addr);
+		if(-1 == (int)s) return -1;
+		return impl_->shards[s]->send_to_fd(addr, fd, off, size);
+	}
+
+	size_t
+	ShardedBehaviorDB::del(AddrType addr)
+	{
+		unsigned int s = impl_->shard_of(addr);
+		if(-1 == (int)s) return -1;
+		return impl_->shards[s]->del(addr);
+	}
+
+	size_t
+	ShardedBehaviorDB::del(AddrType addr, size_t off, size_t size)
+	{
+		unsigned int s = impl_->shard_of(addr);
+		if(-1 == (int)s) return -1;
+		return impl_->shards[s]->del(addr, off, size);
+	}
+
+	size_t
+	ShardedBehaviorDB::put_batch(std::string const* data, AddrType *addrs, size_t cnt)
+	{
+		std::vector<Segment> segs(cnt);
+		for(size_t i=0; i<cnt; ++i){
+			segs[i].data = data[i].data();
+			segs[i].size = data[i].size();
+		}
+		return cnt ? put_batch(&segs[0], cnt, addrs) : 0;
+	}
+
+	size_t
+	ShardedBehaviorDB::put_batch(Segment const* segs, size_t cnt, AddrType *addrs)
+	{
+		put_arg a = { segs, addrs };
+		route_rr r = { impl_ };
+		impl_->dispatch(cnt, r, &put_run, &a);
+
+		size_t rt(0);
+		for(size_t i=0; i<cnt; ++i){
+			if((AddrType)-1 == addrs[i]) // retry on any other shard
+				addrs[i] = put(segs[i].data, segs[i].size);
+			if((AddrType)-1 != addrs[i]) ++rt;
+		}
+		return rt;
+	}
+
+	size_t
+	ShardedBehaviorDB::get_batch(std::string *outputs, size_t max,
+		AddrType const* addrs, size_t cnt)
+	{
+		std::vector<char> done(cnt, 0);
+		get_arg a = { outputs, max, addrs, &done };
+		route_addr r = { impl_, addrs };
+		impl_->dispatch(cnt, r, &get_run, &a);
+
+		size_t rt(0);
+		for(size_t i=0; i<cnt; ++i)
+			rt += done[i];
+		return rt;
+	}
+
+	size_t
+	ShardedBehaviorDB::del_batch(AddrType const* addrs, size_t cnt)
+	{
+		std::vector<size_t> deleted(impl_->shards.size(), 0);
+		del_arg a = { addrs, &deleted };
+		route_addr r = { impl_, addrs };
+		impl_->dispatch(cnt, r, &del_run, &a);
+
+		size_t rt(0);
+		for(size_t i=0; i<deleted.size(); ++i)
+			rt += deleted[i];
+		return rt;
+	}
+
+	size_t
+	ShardedBehaviorDB::del_range(AddrType first, AddrType last)
+	{
+		// each shard deletes its part of the range
+		size_t rt(0);
+		for(unsigned int s=0; s<impl_->shards.size(); ++s){
+			AddrType lo = impl_->beg + s * impl_->span;
+			AddrType hi = (impl_->end - lo > impl_->span) ? 
+				lo + impl_->span : impl_->end;
+			if(first > lo) lo = first;
+			if(last < hi) hi = last;
+			if(lo < hi) rt += impl_->shards[s]->del_range(lo, hi);
+		}
+		return rt;
+	}
+
+	stream_state const*
+	ShardedBehaviorDB::ostream(size_t stream_size)
+	{
+		unsigned int s = impl_->next_shard();
+		stream_state const* rt = impl_->shards[s]->ostream(stream_size);
+		impl_->track(rt, s);
+		return rt;
+	}
+
+	stream_state const*
+	ShardedBehaviorDB::ostream(size_t stream_size, AddrType addr, size_t off)
+	{
+		unsigned int s = impl_->shard_of(addr);
+		if(-1 == (int)s) return 0;
+		stream_state const* rt = impl_->shards[s]->ostream(stream_size, addr, off);
+		impl_->track(rt, s);
+		return rt;
+	}
+
+	stream_state const*
+	ShardedBehaviorDB::istream(size_t stream_size, AddrType addr, size_t off)
+	{
+		unsigned int s = impl_->shard_of(addr);
+		if(-1 == (int)s) return 0;
+		stream_state const* rt = impl_->shards[s]->istream(stream_size, addr, off);
+		impl_->track(rt, s);
+		return rt;
+	}
+
+	stream_state const*
+	ShardedBehaviorDB::stream_write(stream_state const* state, char const* data, size_t size)
+	{
+		unsigned int s = impl_->shard_of(state);
+		if(-1 == (int)s) return 0;
+		return impl_->shards[s]->stream_write(state, data, size);
+	}
+
+	stream_state const*
+	ShardedBehaviorDB::stream_write_from_fd(stream_state const* state, 
+		int fd, size_t size)
+	{
+		unsigned int s = impl_->shard_of(state);
+		if(-1 == (int)s) return 0;
+		return impl_->shards[s]->stream_write_from_fd(state, fd, size);
+	}
+
+	stream_state const*
+	ShardedBehaviorDB::stream_read(stream_state const* state, char* output, size_t size)
+	{
+		unsigned int s = impl_->shard_of(state);
+		if(-1 == (int)s) return 0;
+		return impl_->shards[s]->stream_read(state, output, size);
+	}
+
+	AddrType
+	ShardedBehaviorDB::stream_finish(stream_state const* state)
+	{
+		unsigned int s = impl_->shard_of(state);
+		if(-1 == (int)s) return -1;
+		impl_->untrack(state);
+		return impl_->shards[s]->stream_finish(state);
+	}
+
+	size_t
+	ShardedBehaviorDB::stream_pause(stream_state const* state)
+	{
+		unsigned int s = impl_->shard_of(state);
+		if(-1 == (int)s) return 0;
+
+		// the shard is kept in the handle, so it is routed after restarts
+		return impl_->shards[s]->stream_pause(state) * 
+			impl_->shards.size() + s;
+	}
+
+	stream_state const*
+	ShardedBehaviorDB::stream_buffer(stream_state const* state, size_t size)
+	{
+		unsigned int s = impl_->shard_of(state);
+		if(-1 == (int)s) return 0;
+		return impl_->shards[s]->stream_buffer(state, size);
+	}
+
+	stream_state const*
+	ShardedBehaviorDB::stream_resume(size_t encrypt_handle)
+	{
+		unsigned int s = encrypt_handle % impl_->shards.size();
+		stream_state const* rt = impl_->shards[s]->stream_resume(
+			encrypt_handle / impl_->shards.size());
+		if(rt) impl_->track(rt, s);
+		return rt;
+	}
+
+	void
+	ShardedBehaviorDB::stream_expire(size_t encrypt_handle)
+	{
+		stream_state const* state = stream_resume(encrypt_handle);
+		if(state) stream_abort(state);
+	}
+
+	void
+	ShardedBehaviorDB::stream_abort(stream_state const* state)
+	{
+		unsigned int s = impl_->shard_of(state);
+		if(-1 == (int)s) return;
+		impl_->untrack(state);
+		impl_->shards[s]->stream_abort(state);
+	}
+
+	unsigned int
+	ShardedBehaviorDB::shard_count() const
+	{ return impl_->shards.size(); }
+
+	unsigned int
+	ShardedBehaviorDB::shard_of(AddrType addr) const
+	{ return impl_->shard_of(addr); }
+
+	BehaviorDB &
+	ShardedBehaviorDB::shard(unsigned int i)
+	{
+		if(i >= impl_->shards.size())
+			throw std::out_of_range("ShardedBehaviorDB: no such shard");
+		return *impl_->shards[i];
+	}
+
+	void
+	ShardedBehaviorDB::stat(Stat * ms) const
+	{
+		for(size_t i=0; i<impl_->shards.size(); ++i)
+			impl_->shards[i]->stat(ms);
+	}
+
+	void
+	ShardedBehaviorDB::metrics(std::string *out) const
+	{
+		Stat s;
+		stat(&s);
+		render_prometheus(s, out);
+	}
+
+} // end of namespace BDB
@@ -2,7 +2,89 @@
 #include "bdbImpl.hpp"
 #include "poolImpl.hpp"
 #include "idPool.hpp"
+#include "buf_pool.hpp"
+#include <cmath>
+
 namespace BDB {
+
+	namespace {
+
+		char const* op_names[STAT_OP_CNT] = {
+			"put", "insert", "update", "get", "del", "stream"
+		};
+
+	} // end of anonymous namespace
+
+	LatencyHist::LatencyHist()
+	: total_ns(0), max_ns(0)
+	{
+		for(unsigned int b=0; b<BUCKETS; ++b)
+			count[b] = 0;
+	}
+
+	unsigned long long
+	LatencyHist::samples() const
+	{
+		unsigned long long rt(0);
+		for(unsigned int b=0; b<BUCKETS; ++b)
+			rt += count[b];
+		return rt;
+	}
+
+	unsigned long long
+	LatencyHist::percentile(double p) const
+	{
+		unsigned long long n = samples();
+		if(0 == n) return 0;
+		unsigned long long rank = (unsigned long long)std::ceil(p * n);
+		if(0 == rank) rank = 1;
+
+		unsigned long long seen(0);
+		for(unsigned int b=0; b<BUCKETS; ++b){
+			seen += count[b];
+			if(seen >= rank)
+				return (upper_bound(b) < max_ns) ? upper_bound(b) : max_ns;
+		}
+		return max_ns;
+	}
+
+	void
+	LatencyHist::merge(LatencyHist const& h)
+	{
+		for(unsigned int b=0; b<BUCKETS; ++b)
+			count[b] += h.count[b];
+		total_ns += h.total_ns;
+		if(h.max_ns > max_ns) max_ns = h.max_ns;
+	}
+
+	unsigned int
+	LatencyHist::bucket(unsigned long long ns)
+	{
+		if(ns < 4) return (unsigned int)ns;
+
+#ifdef __GNUC__
+		unsigned int msb = 63 - __builtin_clzll(ns);
+#else
+		unsigned int msb(2);
+		while(ns >> (msb + 1)) ++msb;
+#endif
+		unsigned int b = (msb - 1) * 4 + ((ns >> (msb - 2)) & 3);
+		return (b < BUCKETS) ? b : BUCKETS - 1;
+	}
+
+	unsigned long long
+	LatencyHist::upper_bound(unsigned int b)
+	{
+		if(b < 4) return b;
+		unsigned int msb = b / 4 + 1;
+		return ((unsigned long long)(4 + b % 4 + 1) << (msb - 2)) - 1;
+	}
+
+	void
+	Stat::dump(FILE *fp) const
+	{
+		bdbStater(const_cast<Stat*>(this)).dump(fp);
+	}
 	
 	bdbStater::bdbStater(Stat *s)
 	: s(s)
@@ -12,11 +94,67 @@ namespace BDB {
 	bdbStater::operator()(BDBImpl const* bdb) const
 	{
 
-		(*this)(bdb->global_id_);
+		{
+			opt_lock_guard glk(bdb->gid_mutex_);
+			(*this)(bdb->global_id_);
+		}
 		
 		for(size_t i=0;i< bdb->addrEval.dir_count();++i){
+			opt_lock_guard plk(bdb->pools_[i].mutex());
 			(*this)(bdb->pools_ + i);
 		}
+		
+		bdb->lat_stat_.collect(&s->pools);
+		
+		for(int i=0; i<Stat::ERROR_SLOTS; ++i)
+			s->errors[i] += bdb->err_cnt_[i].load(boost::memory_order_relaxed);
+		
+		// process-wide, not summed
+		s->buf_mem_size = buf_pool::instance().allocated();
+		s->buf_hits = buf_pool::instance().hits();
+		s->buf_misses = buf_pool::instance().misses();
+	}
+
+	void
+	bdbStater::dump(FILE *fp) const
+	{
+		fprintf(fp, "gid_mem_size\t%llu\n", s->gid_mem_size);
+		fprintf(fp, "pool_mem_size\t%llu\n", s->pool_mem_size);
+		fprintf(fp, "disk_size\t%llu\n", s->disk_size);
+		fprintf(fp, "buf_mem_size\t%llu\n", s->buf_mem_size);
+
+		fprintf(fp, "%-4s\t%10s\t%10s\t%10s\t%12s\t%9s\t%9s\t%9s\t%9s\n",
+			"dir", "chunk", "chunks", "slots", "data_bytes", 
+			"occupancy", "int_frag", "ext_frag", "write_amp");
+		for(size_t d=0; d<s->pools.size(); ++d){
+			PoolStat const &ps = s->pools[d];
+			if(0 == ps.slots && 0 == ps.bytes_written) continue;
+			fprintf(fp, "%04x\t%10llu\t%10llu\t%10llu\t%12llu"
+				"\t%9.3f\t%9.3f\t%9.3f\t%9.3f\n", (unsigned int)d, 
+				ps.chunk_size, ps.chunks, ps.slots, ps.data_bytes,
+				ps.occupancy(), ps.internal_fragmentation(),
+				ps.external_fragmentation(), ps.write_amplification());
+		}
+
+		fprintf(fp, "%-4s\t%-8s\t%10s\t%10s\t%10s\t%10s\t%10s\t%10s\n",
+			"dir", "op", "count", "mean_ns", "p50_ns", "p99_ns", 
+			"p999_ns", "max_ns");
+		for(size_t d=0; d<s->pools.size(); ++d){
+			PoolStat const &ps = s->pools[d];
+			for(unsigned int i=0; i<STAT_OP_CNT; ++i){
+				LatencyHist const &h = ps.latency[i];
+				unsigned long long n = h.samples();
+				if(0 == n) continue;
+				fprintf(fp, "%04x\t%-8s\t%10llu\t%10llu\t%10llu\t%10llu"
+					"\t%10llu\t%10llu\n", (unsigned int)d, op_names[i], 
+					n, h.total_ns / n, h.percentile(0.5), 
+					h.percentile(0.99), h.percentile(0.999), h.max_ns);
+			}
+			if(ps.migrations)
+				fprintf(fp, "%04x\t%-8s\t%10llu\t%10llu bytes\n", 
+					(unsigned int)d, "migrate", 
+					ps.migrations, ps.migrated_bytes);
+		}
 	}
 
 	void
@@ -24,11 +162,20 @@ namespace BDB {
 	{
 		(*this)(pool->idPool_);
 
-		s->disk_size += 
-			pool->idPool_->max_used()* 
-			pool->addrEval.chunk_size_estimation(pool->dirID);
+		size_t chunk_size = pool->addrEval.chunk_size_estimation(pool->dirID);
+		s->disk_size += pool->idPool_->max_used() * chunk_size;
+
+		if(s->pools.size() <= pool->dirID)
+			s->pools.resize(pool->dirID + 1);
+		PoolStat &ps = s->pools[pool->dirID];
+		ps.chunk_size = chunk_size;
+		ps.chunks += pool->chunks_;
+		ps.slots += pool->idPool_->max_used();
+		ps.data_bytes += pool->data_bytes_;
+		ps.bytes_requested += pool->bytes_requested_;
+		ps.bytes_written += pool->bytes_written_;
 
-		s->pool_mem_size += MIGBUF_SIZ * 2;
+		s->pool_mem_size += FILEBUF_SIZ;
 	}
 	
 	void
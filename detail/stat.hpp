@@ -27,6 +27,10 @@ namespace BDB {
 		void
 		operator()( IDValPool const *idvp) const;
 
+		/// Print *s in text
+		void
+		dump(FILE *fp) const;
+
 		Stat *s;
 	};
 
@@ -12,13 +12,28 @@ namespace BDB {
 		bool read_write;	// 0 for read and 1 for wrt
 		bool existed;
 		bool error;
+		bool growable;		// output stream opened with npos size
 		AddrType ext_addr;
 		AddrType inter_src_addr;
 		AddrType inter_dest_addr;
 
 		unsigned int offset; 	// offset from chunk begin
-		unsigned int size;  	// size of stream
+		unsigned int size;  	// size of stream, room reserved if growable
 		unsigned int used; 	// read/written size
+
+		// write-combining buffer of output streams; 
+		// data of [used - wbuf_used, used) are pending in wbuf
+		char *wbuf;
+		unsigned int wbuf_cap;
+		unsigned int wbuf_used;
+
+		// input streams: data size of the chunk, read again once 
+		// modify_seq of its pool is no longer data_seq, and 
+		// read-ahead hinted up to ra_end with window ra_win
+		unsigned int data_size;
+		unsigned int data_seq;
+		unsigned int ra_end;
+		unsigned int ra_win;
 	};
 
 } // end of namespace BDB
@@ -0,0 +1,318 @@
+#include "sys_io.hpp"
+#include "trace_scope.hpp"
+#include "profile_scope.hpp"
+#include <cerrno>
+#include <new>
+#ifdef BDB_POSITIONAL_IO
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#else
+#include <io.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+namespace BDB {
+
+	namespace {
+
+		inline size_t
+		iov_size(struct iovec const *iov, int cnt)
+		{
+			size_t total(0);
+			for(int i=0; i<cnt; ++i)
+				total += iov[i].iov_len;
+			return total;
+		}
+
+#ifndef BDB_POSITIONAL_IO
+		// fread or fwrite at pos and put the position of fp back
+		size_t
+		stdio_at(FILE *fp, char *buf, size_t size, off_t pos, bool write)
+		{
+			off_t saved = ftello(fp);
+			if(-1 == saved || 0 != fseeko(fp, pos, SEEK_SET))
+				return -1;
+			size_t rt = write ? 
+				fwrite(buf, 1, size, fp) : fread(buf, 1, size, fp);
+			if(rt < size && ferror(fp)){
+				clearerr(fp);
+				rt = -1;
+			}
+			if(write && 0 != fflush(fp)) rt = -1;
+			if(0 != fseeko(fp, saved, SEEK_SET)) rt = -1;
+			return rt;
+		}
+
+		size_t
+		stdio_iov_at(FILE *fp, struct iovec const *iov, int cnt, off_t pos,
+			bool write)
+		{
+			size_t total(0);
+			for(int i=0; i<cnt; ++i){
+				size_t n = stdio_at(fp, (char*)iov[i].iov_base, 
+					iov[i].iov_len, pos + total, write);
+				if(-1 == n) return -1;
+				total += n;
+				if(n < iov[i].iov_len) break; // EOF
+			}
+			return total;
+		}
+#endif
+
+	} // end of anonymous namespace
+
+	size_t
+	pread_full(FILE *fp, void *buf, size_t size, off_t pos)
+	{
+		TRACE_SCOPE(TRACE_FILE_READ, -1, -1, size);
+		PROFILE_SCOPE(PROF_DATA);
+		char *dest = static_cast<char*>(buf);
+#ifdef BDB_POSITIONAL_IO
+		int fd = fileno(fp);
+		size_t total(0);
+		while(total < size){
+			ssize_t cnt = pread(fd, dest + total, size - total, pos + total);
+			if(cnt < 0){
+				if(EINTR == errno) continue;
+				return -1;
+			}
+			if(0 == cnt) break; // EOF
+			total += cnt;
+		}
+		return total;
+#else
+		return stdio_at(fp, dest, size, pos, false);
+#endif
+	}
+
+	size_t
+	pwritev_full(FILE *fp, struct iovec *iov, int cnt, off_t pos)
+	{
+		TRACE_SCOPE(TRACE_FILE_WRITE, -1, -1, iov_size(iov, cnt));
+		PROFILE_SCOPE(PROF_DATA);
+#ifdef BDB_POSITIONAL_IO
+		int fd = fileno(fp);
+		size_t total(0);
+		while(cnt > 0){
+			ssize_t written = pwritev(fd, iov, cnt, pos + total);
+			if(written < 0){
+				if(EINTR == errno) continue;
+				return -1;
+			}
+			total += written;
+			// skip segments written completely
+			while(cnt > 0 && (size_t)written >= iov->iov_len){
+				written -= iov->iov_len;
+				++iov; --cnt;
+			}
+			if(cnt > 0){
+				iov->iov_base = (char*)iov->iov_base + written;
+				iov->iov_len -= written;
+			}
+		}
+		return total;
+#else
+		return stdio_iov_at(fp, iov, cnt, pos, true);
+#endif
+	}
+
+	void
+	advise_will_need(FILE *fp, off_t pos, size_t size)
+	{
+#ifdef POSIX_FADV_WILLNEED
+		posix_fadvise(fileno(fp), pos, size, POSIX_FADV_WILLNEED);
+#else
+		(void)fp; (void)pos; (void)size;
+#endif
+	}
+
+	size_t
+	preadv_full(FILE *fp, struct iovec *iov, int cnt, off_t pos)
+	{
+		TRACE_SCOPE(TRACE_FILE_READ, -1, -1, iov_size(iov, cnt));
+		PROFILE_SCOPE(PROF_DATA);
+#ifdef BDB_POSITIONAL_IO
+		int fd = fileno(fp);
+		size_t total(0);
+		while(cnt > 0){
+			ssize_t got = preadv(fd, iov, cnt, pos + total);
+			if(got < 0){
+				if(EINTR == errno) continue;
+				return -1;
+			}
+			if(0 == got) break; // EOF
+			total += got;
+			while(cnt > 0 && (size_t)got >= iov->iov_len){
+				got -= iov->iov_len;
+				++iov; --cnt;
+			}
+			if(cnt > 0){
+				iov->iov_base = (char*)iov->iov_base + got;
+				iov->iov_len -= got;
+			}
+		}
+		return total;
+#else
+		return stdio_iov_at(fp, iov, cnt, pos, false);
+#endif
+	}
+
+	size_t
+	send_range(FILE *fp, int out_fd, off_t pos, size_t size)
+	{
+		TRACE_SCOPE(TRACE_FILE_READ, -1, -1, size);
+		PROFILE_SCOPE(PROF_DATA);
+		size_t total(0);
+#ifdef __linux__
+		int fd = fileno(fp);
+		while(total < size){
+			off_t at = pos + total;
+			ssize_t cnt = sendfile(out_fd, fd, &at, size - total);
+			if(cnt < 0){
+				if(EINTR == errno) continue;
+				if(EAGAIN == errno) return total;
+				// out_fd can not be written by sendfile
+				if(0 == total && (EINVAL == errno || ENOSYS == errno)) break;
+				return -1;
+			}
+			if(0 == cnt) return total; // EOF
+			total += cnt;
+		}
+		if(total == size) return total;
+#endif
+		char buf[16*1024];
+		while(total < size){
+			size_t want = (size - total < sizeof(buf)) ? size - total : sizeof(buf);
+			size_t got = pread_full(fp, buf, want, pos + total);
+			if((size_t)-1 == got) return -1;
+			size_t put(0);
+			while(put < got){
+				long cnt = write(out_fd, buf + put, got - put);
+				if(cnt < 0){
+					if(EINTR == errno) continue;
+					if(EAGAIN == errno) return total + put;
+					return -1;
+				}
+				put += cnt;
+			}
+			total += got;
+			if(got < want) break; // EOF
+		}
+		return total;
+	}
+
+	size_t
+	recv_range(FILE *fp, int in_fd, off_t pos, size_t size)
+	{
+		TRACE_SCOPE(TRACE_FILE_WRITE, -1, -1, size);
+		PROFILE_SCOPE(PROF_DATA);
+		size_t total(0);
+#ifdef __linux__
+		int fd = fileno(fp);
+#ifdef BDB_HAVE_COPY_FILE_RANGE
+		// files are copied within the kernel
+		while(total < size){
+			loff_t at = pos + total;
+			ssize_t cnt = copy_file_range(in_fd, 0, fd, &at, size - total, 0);
+			if(cnt < 0){
+				if(EINTR == errno) continue;
+				if(0 == total && (EINVAL == errno || EXDEV == errno || 
+					ENOSYS == errno || EBADF == errno || EOPNOTSUPP == errno))
+					break;
+				return -1;
+			}
+			if(0 == cnt) return total; // EOF
+			total += cnt;
+		}
+		if(total == size) return total;
+#endif
+
+		// pipes and sockets are moved page by page through a pipe
+		int pp[2];
+		if(0 == pipe(pp)){
+			bool spliced(true);
+			while(total < size){
+				ssize_t in = splice(in_fd, 0, pp[1], 0, size - total, SPLICE_F_MOVE);
+				if(in < 0){
+					if(EINTR == errno) continue;
+					if(0 == total && EINVAL == errno){
+						spliced = false;
+						break;
+					}
+					if(EAGAIN != errno) total = -1;
+					break;
+				}
+				if(0 == in) break; // EOF
+				while(in > 0){
+					loff_t at = pos + total;
+					ssize_t out = splice(pp[0], 0, fd, &at, in, SPLICE_F_MOVE);
+					if(out < 0 && EINTR == errno) continue;
+					if(out <= 0){
+						close(pp[0]);
+						close(pp[1]);
+						return -1;
+					}
+					in -= out;
+					total += out;
+				}
+			}
+			close(pp[0]);
+			close(pp[1]);
+			if(spliced) return total;
+		}
+#endif
+		char buf[16*1024];
+		while(total < size){
+			size_t want = (size - total < sizeof(buf)) ? size - total : sizeof(buf);
+			long got = read(in_fd, buf, want);
+			if(got < 0){
+				if(EINTR == errno) continue;
+				if(EAGAIN == errno) return total;
+				return -1;
+			}
+			if(0 == got) break; // EOF
+			struct iovec iov = { buf, (size_t)got };
+			if((size_t)got != pwritev_full(fp, &iov, 1, pos + total))
+				return -1;
+			total += got;
+		}
+		return total;
+	}
+
+	char const*
+	map_range(FILE *fp, off_t pos, size_t size)
+	{
+#ifdef BDB_POSITIONAL_IO
+		static long const page = sysconf(_SC_PAGESIZE);
+		off_t base = pos - pos % page;
+		size_t len = size + (pos - base);
+		void *m = mmap(0, len, PROT_READ, MAP_SHARED, fileno(fp), base);
+		if(MAP_FAILED == m) return 0;
+		return static_cast<char const*>(m) + (pos - base);
+#else
+		char *copy = new (std::nothrow) char[size];
+		if(copy && size != pread_full(fp, copy, size, pos)){
+			delete [] copy;
+			copy = 0;
+		}
+		return copy;
+#endif
+	}
+
+	void
+	unmap_range(char const* data, size_t size)
+	{
+#ifdef BDB_POSITIONAL_IO
+		static long const page = sysconf(_SC_PAGESIZE);
+		size_t lead = (size_t)data % page;
+		munmap(const_cast<char*>(data - lead), size + lead);
+#else
+		(void)size;
+		delete [] data;
+#endif
+	}
+
+} // end of namespace BDB
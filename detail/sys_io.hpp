@@ -0,0 +1,116 @@
+#ifndef _BDB_SYS_IO_HPP
+#define _BDB_SYS_IO_HPP
+
+#include "common.hpp"
+#include <cstdio>
+
+// POSIX positional I/O; elsewhere these functions seek the stdio
+// stream of fp, so callers must hold the lock guarding fp
+#ifndef _WIN32
+#define BDB_POSITIONAL_IO
+#include <sys/types.h>
+#include <sys/uio.h>
+#else
+struct iovec
+{
+	void *iov_base;
+	size_t iov_len;
+};
+#endif
+
+// Maximum iovec count passed to one pwritev
+#define SYS_IOV_MAX 1024
+
+namespace BDB {
+
+	/** @brief Positional read that bypasses stdio buffering
+	 *  @param fp File opened by fopen. Pending writes of fp must 
+	 *  have been flushed.
+	 *  @param buf
+	 *  @param size
+	 *  @param pos Absolute file position to read from
+	 *  @return Bytes read. Less than size on EOF, -1 on failure.
+	 *  @remark Position of fp is not changed. With 
+	 *  BDB_POSITIONAL_IO this function can be called concurrently 
+	 *  with others using fp.
+	 */
+	size_t
+	pread_full(FILE *fp, void *buf, size_t size, off_t pos);
+
+	/** @brief Positional gather write that bypasses stdio buffering
+	 *  @param fp File opened by fopen. It must have been flushed so 
+	 *  that neither pending writes nor stale read buffer exists.
+	 *  @param iov Segments written back to back from pos. It is 
+	 *  modified to track partial writes.
+	 *  @param cnt Number of segments, at most SYS_IOV_MAX.
+	 *  @param pos Absolute file position to write to
+	 *  @return Bytes written or -1 on failure.
+	 */
+	size_t
+	pwritev_full(FILE *fp, struct iovec *iov, int cnt, off_t pos);
+
+	/** @brief Positional scatter read that bypasses stdio buffering
+	 *  @param fp File opened by fopen. Pending writes of fp must 
+	 *  have been flushed.
+	 *  @param iov Segments filled back to back from pos. It is 
+	 *  modified to track partial reads.
+	 *  @param cnt Number of segments, at most SYS_IOV_MAX.
+	 *  @param pos Absolute file position to read from
+	 *  @return Bytes read. Less than requested on EOF, -1 on failure.
+	 */
+	size_t
+	preadv_full(FILE *fp, struct iovec *iov, int cnt, off_t pos);
+
+	/** @brief Hint that [pos, pos+size) of a file will be read soon
+	 *  @remark No-op where posix_fadvise is unavailable.
+	 */
+	void
+	advise_will_need(FILE *fp, off_t pos, size_t size);
+
+	/** @brief Copy [pos, pos+size) of a file to a descriptor
+	 *  @param fp File opened by fopen. Pending writes of fp must 
+	 *  have been flushed.
+	 *  @param out_fd Socket, pipe or file to write to.
+	 *  @return Bytes sent, less than size if out_fd would block or 
+	 *  EOF is reached. -1 on failure.
+	 *  @remark sendfile is used where available, otherwise data are
+	 *  copied through a small stack buffer.
+	 */
+	size_t
+	send_range(FILE *fp, int out_fd, off_t pos, size_t size);
+
+	/** @brief Copy size bytes from a descriptor to [pos, pos+size) 
+	 *  of a file
+	 *  @param fp File opened by fopen. It must have been flushed so 
+	 *  that neither pending writes nor stale read buffer exists.
+	 *  @param in_fd File, pipe or socket read from its current 
+	 *  position.
+	 *  @return Bytes copied, less than size if in_fd reaches EOF or 
+	 *  would block. -1 on failure.
+	 *  @remark copy_file_range is used for files and splice through 
+	 *  a pipe for others where available, otherwise data are copied 
+	 *  through a small stack buffer.
+	 */
+	size_t
+	recv_range(FILE *fp, int in_fd, off_t pos, size_t size);
+
+	/** @brief Map [pos, pos+size) of a file read-only
+	 *  @param fp File opened by fopen. Pending writes of fp must 
+	 *  have been flushed.
+	 *  @return Address of byte pos in the mapping, 0 on failure.
+	 *  @remark pos need not be page aligned. size must not be 0.
+	 *  Without BDB_POSITIONAL_IO the range is copied to the heap.
+	 */
+	char const*
+	map_range(FILE *fp, off_t pos, size_t size);
+
+	/** @brief Unmap a range mapped by map_range
+	 *  @param data Returned by map_range.
+	 *  @param size Size passed to map_range.
+	 */
+	void
+	unmap_range(char const* data, size_t size);
+
+} // end of namespace BDB
+
+#endif // end of header
@@ -0,0 +1,143 @@
+#include "trace_scope.hpp"
+#include "access_log.hpp"
+#include "boost/atomic.hpp"
+#include "boost/thread/tss.hpp"
+#include <stdexcept>
+
+namespace BDB {
+
+	namespace {
+
+		boost::atomic<TraceSink*> sink_in_use(0);
+
+		// threads are numbered in order of their first event;
+		// the rest is of the innermost scope of the thread
+		struct trace_thread
+		{
+			unsigned int id;
+			unsigned int op;
+			int pool;
+			AddrType addr;
+		};
+		boost::thread_specific_ptr<trace_thread> this_trace_thread;
+		boost::atomic<unsigned int> next_thread(1);
+
+		trace_thread&
+		current_thread()
+		{
+			trace_thread *t = this_trace_thread.get();
+			if(0 == t){
+				t = new trace_thread;
+				t->id = next_thread.fetch_add(1, boost::memory_order_relaxed);
+				t->op = ACC_OP_CNT;
+				t->pool = -1;
+				t->addr = -1;
+				this_trace_thread.reset(t);
+			}
+			return *t;
+		}
+
+	} // end of anonymous namespace
+
+	char const*
+	trace_stage_name(unsigned int stage)
+	{
+		static char const* names[TRACE_STAGE_CNT] = {
+			"op", "pool_read", "pool_write", "header_read", "header_write",
+			"seek", "file_read", "file_write", "commit", "access_log"
+		};
+		return (stage < TRACE_STAGE_CNT) ? names[stage] : "unknown";
+	}
+
+	char const*
+	trace_op_name(unsigned int op)
+	{ return (op < ACC_OP_CNT) ? access_op_name(op) : "none"; }
+
+	bool
+	set_trace_sink(TraceSink *sink)
+	{
+		sink_in_use.store(sink, boost::memory_order_release);
+#ifdef BDB_TRACE
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	TraceSink*
+	trace_scope::trace_sink()
+	{ return sink_in_use.load(boost::memory_order_acquire); }
+
+	void
+	trace_scope::begin(unsigned int stage, unsigned int op, int pool,
+		AddrType addr, size_t bytes)
+	{
+		trace_thread &t = current_thread();
+		outer_op_ = t.op;
+		outer_pool_ = t.pool;
+		outer_addr_ = t.addr;
+		t.op = op = ((unsigned int)INHERIT == op) ? t.op : op;
+		t.pool = pool = (INHERIT == pool) ? t.pool : pool;
+		addr = ((AddrType)INHERIT == addr) ? t.addr : addr;
+		// addresses of stages in pools are internal ones
+		t.addr = (TRACE_OP == stage) ? (AddrType)INHERIT : addr;
+
+		ev_.stage = stage;
+		ev_.begin = true;
+		ev_.op = op;
+		ev_.thread = t.id;
+		ev_.pool = pool;
+		ev_.addr = addr;
+		ev_.bytes = bytes;
+		ev_.time = access_log::now();
+		sink_->event(ev_);
+	}
+
+	void
+	trace_scope::end()
+	{
+		ev_.begin = false;
+		ev_.time = access_log::now();
+		sink_->event(ev_);
+		trace_thread &t = current_thread();
+		t.op = outer_op_;
+		t.pool = outer_pool_;
+		t.addr = outer_addr_;
+	}
+
+	ChromeTraceSink::ChromeTraceSink(char const* fname)
+	: file_(0), first_(true), base_(access_log::now())
+	{
+		if(0 == (file_ = fopen(fname, "wb")))
+			throw std::runtime_error("create trace file failed\n");
+		fputs("{\"traceEvents\":[", file_);
+	}
+
+	ChromeTraceSink::~ChromeTraceSink()
+	{
+		fputs("\n]}\n", file_);
+		fclose(file_);
+	}
+
+	void
+	ChromeTraceSink::event(TraceEvent const &ev)
+	{
+		char const* name = (TRACE_OP == ev.stage) ?
+			trace_op_name(ev.op) : trace_stage_name(ev.stage);
+		// events before this sink was created are placed at 0
+		double ts = (ev.time > base_) ? (ev.time - base_) / 1000.0 : 0;
+
+		boost::mutex::scoped_lock lock(mutex_);
+		fprintf(file_, "%s\n{\"name\":\"%s\",\"cat\":\"bdb\","
+			"\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u",
+			first_ ? "" : ",", name, ev.begin ? 'B' : 'E', ts, ev.thread);
+		first_ = false;
+		if(ev.begin)
+			fprintf(file_, ",\"args\":{\"op\":\"%s\",\"pool\":%d,"
+				"\"addr\":%u,\"bytes\":%lu}",
+				trace_op_name(ev.op), ev.pool, ev.addr,
+				(unsigned long)ev.bytes);
+		fputs("}", file_);
+	}
+
+} // end of namespace BDB
@@ -0,0 +1,69 @@
+#ifndef _BDB_TRACE_SCOPE_HPP
+#define _BDB_TRACE_SCOPE_HPP
+
+#include "trace.hpp"
+
+// Trace points; they expand to nothing unless BDB_TRACE is defined.
+// TRACE_OP_SCOPE marks an operation of BDBImpl, TRACE_SCOPE a stage
+// of it. Both last to the end of the enclosing block. A pool of -1 or
+// an address of -1 is taken from the enclosing stage of the thread.
+#ifdef BDB_TRACE
+#define TRACE_CAT2_(a, b) a##b
+#define TRACE_CAT_(a, b) TRACE_CAT2_(a, b)
+#define TRACE_OP_SCOPE(op, addr, bytes) \
+	BDB::trace_scope TRACE_CAT_(trace_scope_, __LINE__)( \
+		BDB::TRACE_OP, (op), -1, (addr), (bytes))
+#define TRACE_SCOPE(stage, pool, addr, bytes) \
+	BDB::trace_scope TRACE_CAT_(trace_scope_, __LINE__)( \
+		(stage), BDB::trace_scope::INHERIT, (pool), (addr), (bytes))
+#else
+#define TRACE_OP_SCOPE(op, addr, bytes)
+#define TRACE_SCOPE(stage, pool, addr, bytes)
+#endif
+
+namespace BDB {
+
+	/** @brief Emit begin and end events of a stage to the sink
+	 *  @details The sink is looked up once at construction so that
+	 *  every begin is matched by an end. Operation, pool and address
+	 *  of a scope are inherited by scopes nested in it on the same
+	 *  thread unless they are given.
+	 */
+	class trace_scope
+	{
+	public:
+		enum { INHERIT = -1 };
+
+		trace_scope(unsigned int stage, unsigned int op, int pool,
+			AddrType addr, size_t bytes)
+		: sink_(trace_sink())
+		{ if(sink_) begin(stage, op, pool, addr, bytes); }
+
+		~trace_scope()
+		{ if(sink_) end(); }
+
+	private:
+		trace_scope(trace_scope const &cp);
+		trace_scope& operator=(trace_scope const &cp);
+
+		static TraceSink*
+		trace_sink();
+
+		void
+		begin(unsigned int stage, unsigned int op, int pool,
+			AddrType addr, size_t bytes);
+
+		void
+		end();
+
+		TraceSink *sink_;
+		TraceEvent ev_;
+		// operation, pool and address of the enclosing scope
+		unsigned int outer_op_;
+		int outer_pool_;
+		AddrType outer_addr_;
+	};
+
+} // end of namespace BDB
+
+#endif // end of header
@@ -0,0 +1,54 @@
+#include "bdb.hpp"
+#include "access_rec.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+int main(int argc, char** argv)
+{
+	using namespace BDB;
+
+	if(argc < 2){
+		printf("./acclog work_dir/\n");
+		return 1;
+	}
+
+	int failure(0);
+	std::string data(10000, 'a');
+
+	printf("==== sampled binary access log ====\n");
+	{
+		Config conf;
+		conf.root_dir = argv[1];
+		conf.access_log_sample = 2;
+		{
+			BehaviorDB bdb(conf);
+			AddrType addrs[10];
+			for(int i=0; i<10; ++i)
+				addrs[i] = bdb.put(data);
+			for(int i=0; i<10; ++i)
+				bdb.del(addrs[i]);
+		}
+		// the writer drains the ring before the BehaviorDB is gone
+		std::string fname = std::string(argv[1]) + "access.log";
+		FILE *fp = fopen(fname.c_str(), "rb");
+		char magic[ACCESS_LOG_MAGIC_LEN] = {};
+		access_record r;
+		size_t puts(0), dels(0);
+		if(fp){
+			fread(magic, ACCESS_LOG_MAGIC_LEN, 1, fp);
+			while(1 == fread(&r, sizeof(r), 1, fp)){
+				if(ACC_PUT == r.op && data.size() == r.arg[0]) ++puts;
+				if(ACC_DEL == r.op) ++dels;
+			}
+			fclose(fp);
+		}
+		bool magic_ok =
+			0 == memcmp(magic, ACCESS_LOG_MAGIC, ACCESS_LOG_MAGIC_LEN);
+		printf("should: 1 5 5\n");
+		printf("result: %d %d %d\n", (int)magic_ok, (int)puts, (int)dels);
+		if(!magic_ok || 5 != puts || 5 != dels) ++failure;
+	}
+
+	return failure ? 1 : 0;
+}
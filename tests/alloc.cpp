@@ -0,0 +1,104 @@
+#include "bdb.hpp"
+#include "boost/atomic.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+// Heap allocations made through operator new in this process
+namespace {
+	boost::atomic<unsigned long> allocations(0);
+}
+
+void*
+operator new(size_t size)
+{
+	allocations.fetch_add(1, boost::memory_order_relaxed);
+	if(void *p = malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void*
+operator new[](size_t size)
+{ return operator new(size); }
+
+void
+operator delete(void *p) throw()
+{ free(p); }
+
+void
+operator delete[](void *p) throw()
+{ free(p); }
+
+#ifdef __cpp_sized_deallocation
+void
+operator delete(void *p, size_t) throw()
+{ free(p); }
+
+void
+operator delete[](void *p, size_t) throw()
+{ free(p); }
+#endif
+
+namespace {
+
+	unsigned long
+	allocated()
+	{ return allocations.load(boost::memory_order_relaxed); }
+
+} // end of anonymous namespace
+
+int main(int argc, char** argv)
+{
+	using namespace BDB;
+
+	if(argc < 2){
+		printf("./alloc work_dir/\n");
+		return 1;
+	}
+
+	Config conf;
+	conf.root_dir = argv[1];
+	BehaviorDB bdb(conf);
+
+	int failure(0);
+	char data[1000], buf[2000];
+	memset(data, 'a', sizeof(data));
+	std::string out;
+	out.reserve(sizeof(buf));
+
+	unsigned long counts[5] = {};
+	// the first rounds fill caches, buffers and ID pools
+	for(int round=0; round<200; ++round){
+		bool warm = (round >= 100);
+		unsigned long before = allocated();
+		AddrType addr = bdb.put(data, 100);
+		if(warm) counts[0] += allocated() - before;
+
+		before = allocated();
+		addr = bdb.put(data, 100, addr);
+		if(warm) counts[1] += allocated() - before;
+
+		before = allocated();
+		bdb.get(buf, sizeof(buf), addr);
+		if(warm) counts[2] += allocated() - before;
+
+		before = allocated();
+		bdb.get(&out, sizeof(buf), addr);
+		if(warm) counts[3] += allocated() - before;
+
+		before = allocated();
+		bdb.del(addr);
+		if(warm) counts[4] += allocated() - before;
+	}
+
+	printf("==== heap allocations of put, append, get and del ====\n");
+	printf("should: 0 0 0 0 0\n");
+	printf("result: %lu %lu %lu %lu %lu\n",
+		counts[0], counts[1], counts[2], counts[3], counts[4]);
+	for(int i=0; i<5; ++i)
+		if(counts[i]) ++failure;
+
+	return failure ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+#include "async.hpp"
+#include "bdb.hpp"
+#include "boost/atomic.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define WORKER_CNT 4
+#define ADDR_CNT 16
+#define APPEND_CNT 20
+
+boost::atomic<int> called(0);
+
+void count(BDB::AddrType)
+{ ++called; }
+
+int main(int argc, char** argv)
+{
+	using namespace BDB;
+
+	if(argc < 2){
+		printf("./async work_dir/\n");
+		return 1;
+	}
+
+	Config conf;
+	conf.root_dir = argv[1];
+	conf.concurrent = true;
+	BehaviorDB bdb(conf);
+	int failure(0);
+	
+	{
+		AsyncBehaviorDB abdb(bdb, WORKER_CNT);
+
+		printf("==== appends are ordered per address ====\n");
+		std::vector<boost::unique_future<AddrType> > puts;
+		for(int i=0; i<ADDR_CNT; ++i)
+			puts.push_back(abdb.async_put("x"));
+		
+		std::vector<AddrType> addrs;
+		for(int i=0; i<ADDR_CNT; ++i)
+			addrs.push_back(puts[i].get());
+
+		// pipeline without waiting
+		std::vector<boost::unique_future<AddrType> > appends;
+		for(int j=0; j<APPEND_CNT; ++j)
+			for(int i=0; i<ADDR_CNT; ++i)
+				appends.push_back(abdb.async_put(
+					std::string(1, 'a' + j), addrs[i], npos, &count));
+		
+		std::vector<boost::unique_future<std::string> > gets;
+		for(int i=0; i<ADDR_CNT; ++i)
+			gets.push_back(abdb.async_get(addrs[i], 1024));
+
+		std::string should("x");
+		for(int j=0; j<APPEND_CNT; ++j)
+			should += (char)('a' + j);
+
+		int mismatch(0);
+		std::string rec;
+		for(int i=0; i<ADDR_CNT; ++i){
+			rec = gets[i].get();
+			if(rec != should) ++mismatch;
+		}
+		printf("should: %s 0 %d\n", should.c_str(), ADDR_CNT * APPEND_CNT);
+		printf("result: %s %d %d\n", rec.c_str(), mismatch, called.load());
+		if(mismatch || ADDR_CNT * APPEND_CNT != called) ++failure;
+
+		printf("==== stream through executor ====\n");
+		stream_state const* ss = abdb.async_ostream(8).get();
+		abdb.async_stream_write(ss, "toma");
+		abdb.async_stream_write(ss, "toes");
+		AddrType saddr = abdb.async_stream_finish(ss).get();
+		
+		ss = abdb.async_istream(8, saddr).get();
+		std::string part1 = abdb.async_stream_read(ss, 4).get();
+		std::string part2 = abdb.async_stream_read(ss, 100).get();
+		abdb.async_stream_finish(ss).get();
+		printf("should: toma toes\n");
+		printf("result: %s %s\n", part1.c_str(), part2.c_str());
+		if(part1 != "toma" || part2 != "toes") ++failure;
+		
+		printf("==== del ====\n");
+		size_t del_rt = abdb.async_del(saddr).get();
+		printf("should: 0 \n");
+		printf("result: %d %s\n", (int)del_rt, 
+			abdb.async_get(saddr, 10).get().c_str());
+		if(0 != del_rt) ++failure;
+	}
+
+	return failure ? 1 : 0;
+}
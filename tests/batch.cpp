@@ -0,0 +1,203 @@
+#include "bdb.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define BATCH_CNT 100
+
+int main(int argc, char** argv)
+{
+	using namespace BDB;
+
+	if(argc < 2){
+		printf("./batch work_dir/\n");
+		return 1;
+	}
+
+	Config conf;
+	conf.root_dir = argv[1];
+	BehaviorDB bdb(conf);
+	int failure(0);
+
+	// sizes over several pools
+	std::vector<std::string> data(BATCH_CNT);
+	std::vector<Segment> segs(BATCH_CNT);
+	for(int i=0; i<BATCH_CNT; ++i){
+		data[i].assign(1 + (i * 37) % 300, (char)('a' + i % 26));
+		segs[i].data = data[i].data();
+		segs[i].size = data[i].size();
+	}
+	
+	printf("==== put_batch ====\n");
+	std::vector<AddrType> addrs(BATCH_CNT);
+	size_t cnt = bdb.put_batch(&segs[0], BATCH_CNT, &addrs[0]);
+	int mismatch(0);
+	std::string rec;
+	for(int i=0; i<BATCH_CNT; ++i){
+		bdb.get(&rec, 1024, addrs[i]);
+		if(rec != data[i]) ++mismatch;
+	}
+	printf("should: %d 0\n", BATCH_CNT);
+	printf("result: %d %d\n", (int)cnt, mismatch);
+	if(BATCH_CNT != cnt || mismatch) ++failure;
+
+	printf("==== put_batch after reopen ====\n");
+	{
+		BehaviorDB reopen(conf);
+		mismatch = 0;
+		for(int i=0; i<BATCH_CNT; ++i){
+			reopen.get(&rec, 1024, addrs[i]);
+			if(rec != data[i]) ++mismatch;
+		}
+	}
+	printf("should: 0\n");
+	printf("result: %d\n", mismatch);
+	if(mismatch) ++failure;
+
+	printf("==== get_batch ====\n");
+	{
+		// reversed order, one deleted address and one short buffer
+		bdb.del(addrs[BATCH_CNT/2]);
+		std::vector<AddrType> raddrs(addrs.rbegin(), addrs.rend());
+		std::vector<std::vector<char> > bufs(BATCH_CNT, std::vector<char>(1024));
+		std::vector<char*> bptrs(BATCH_CNT);
+		std::vector<size_t> sizes(BATCH_CNT, 1024);
+		for(int i=0; i<BATCH_CNT; ++i)
+			bptrs[i] = &bufs[i][0];
+		sizes[0] = 1;
+		cnt = bdb.get_batch(&raddrs[0], BATCH_CNT, &bptrs[0], &sizes[0]);
+		mismatch = 0;
+		for(int i=1; i<BATCH_CNT; ++i){
+			std::string const& d = data[BATCH_CNT - 1 - i];
+			if(BATCH_CNT - 1 - i == BATCH_CNT/2){
+				if(0 != sizes[i]) ++mismatch;
+			}else if(d != std::string(bptrs[i], sizes[i]))
+				++mismatch;
+		}
+		if(1 != sizes[0] || bptrs[0][0] != data[BATCH_CNT-1][0])
+			++mismatch;
+		printf("should: %d 0\n", BATCH_CNT - 1);
+		printf("result: %d %d\n", (int)cnt, mismatch);
+		if(BATCH_CNT - 1 != cnt || mismatch) ++failure;
+	}
+
+	printf("==== append ====\n");
+	{
+		// records appended to a hot set of addresses in turns
+		AddrType hot[5];
+		std::string expect[5];
+		for(int i=0; i<5; ++i){
+			expect[i] = "head";
+			hot[i] = bdb.put(expect[i]);
+		}
+		AddrType bad = addrs[BATCH_CNT/2]; // deleted above
+		char rec_buf[64];
+		std::vector<std::string> recs(30);
+		std::vector<WriteVector> wvs(31);
+		for(int i=0; i<30; ++i){
+			sprintf(rec_buf, "[%d:%d]", i % 5, i);
+			recs[i] = rec_buf;
+			expect[i % 5] += recs[i];
+			wvs[i].buffer = recs[i].data();
+			wvs[i].size = recs[i].size();
+			wvs[i].address = &hot[i % 5];
+		}
+		wvs[30].buffer = "x";
+		wvs[30].size = 1;
+		wvs[30].address = &bad;
+		cnt = bdb.append(&wvs[0], wvs.size());
+		mismatch = 0;
+		for(int i=0; i<5; ++i){
+			bdb.get(&rec, 1024, hot[i]);
+			if(rec != expect[i]) ++mismatch;
+		}
+		printf("should: 30 0 %d\n", -1);
+		printf("result: %d %d %d\n", (int)cnt, mismatch, (int)bad);
+		if(30 != cnt || mismatch || (AddrType)-1 != bad) ++failure;
+	}
+
+	printf("==== putv/appendv/getv ====\n");
+	{
+		std::string head("HEAD"), body(200, 'b'), tail("TAIL");
+		Segment sv[3] = { 
+			{ head.data(), head.size() }, 
+			{ body.data(), body.size() }, 
+			{ tail.data(), tail.size() } 
+		};
+		std::string expect = head + body + tail;
+		AddrType va = bdb.putv(sv, 3);
+		bdb.get(&rec, 4096, va);
+		mismatch = (rec != expect);
+
+		// in place, then large enough to migrate
+		bdb.appendv(sv, 1, va);
+		expect += head;
+		std::string big(1000, 'g');
+		Segment mv[2] = { { big.data(), big.size() }, { tail.data(), tail.size() } };
+		if(va != bdb.appendv(mv, 2, va)) ++mismatch;
+		expect += big + tail;
+		bdb.get(&rec, 4096, va);
+		if(rec != expect) ++mismatch;
+
+		// scatter from an offset into small buffers
+		char b1[3], b2[100], b3[4096];
+		MutableSegment ov[3] = { { b1, sizeof(b1) }, { b2, sizeof(b2) }, { b3, sizeof(b3) } };
+		size_t got = bdb.getv(ov, 3, va, 2);
+		std::string scattered = std::string(b1, 3) + std::string(b2, 100) + 
+			std::string(b3, got - 103);
+		if(got != expect.size() - 2 || scattered != expect.substr(2))
+			++mismatch;
+		printf("should: 0\n");
+		printf("result: %d\n", mismatch);
+		if(mismatch) ++failure;
+	}
+
+	printf("==== del_batch/del_range ====\n");
+	{
+		std::vector<AddrType> da(BATCH_CNT * 2);
+		std::vector<Segment> ds(BATCH_CNT * 2, segs[0]);
+		bdb.put_batch(&ds[0], ds.size(), &da[0]);
+		
+		// first half by del_batch, including a duplicate
+		std::vector<AddrType> victims(da.begin(), da.begin() + BATCH_CNT);
+		victims.push_back(da[0]);
+		size_t batch_cnt = bdb.del_batch(&victims[0], victims.size());
+
+		// then a range over part of the second half
+		AddrType lo = da[BATCH_CNT + 10], hi = da[BATCH_CNT + 60];
+		size_t expect_cnt(0);
+		for(AddrType a = lo; a < hi; ++a)
+			if(bdb.get(&rec, 1, a)) ++expect_cnt;
+		size_t range_cnt = bdb.del_range(lo, hi);
+		
+		BehaviorDB reopen(conf);
+		mismatch = 0;
+		for(size_t i=0; i<da.size(); ++i){
+			bool gone = (i < BATCH_CNT) || (da[i] >= lo && da[i] < hi);
+			if(gone != (0 == bdb.get(&rec, 1024, da[i]))) ++mismatch;
+			if(gone != (0 == reopen.get(&rec, 1024, da[i]))) ++mismatch;
+		}
+		printf("should: %d %d 0\n", BATCH_CNT, (int)expect_cnt);
+		printf("result: %d %d %d\n", (int)batch_cnt, (int)range_cnt, mismatch);
+		if(BATCH_CNT != batch_cnt || expect_cnt != range_cnt || mismatch) 
+			++failure;
+	}
+
+	printf("==== del_range over all addresses ====\n");
+	{
+		// every address written so far is below bound
+		AddrType bound = bdb.put("x", 1) + 1;
+		size_t live(0), left(0);
+		for(AddrType a = 0; a < bound; ++a)
+			if(bdb.get(&rec, 1, a)) ++live;
+		// clipped to the highest address in use
+		size_t range_cnt = bdb.del_range(0, (AddrType)-1);
+		for(AddrType a = 0; a < bound; ++a)
+			if(bdb.get(&rec, 1, a)) ++left;
+		printf("should: %d 0\n", (int)live);
+		printf("result: %d %d\n", (int)range_cnt, (int)left);
+		if(live != range_cnt || left) ++failure;
+	}
+
+	return failure ? 1 : 0;
+}
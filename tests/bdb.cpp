@@ -193,6 +193,10 @@ int main(int argc, char** argv)
 	printf("disk size: ");
 	print_in_proper_unit(stat.disk_size);
 	printf("\n");
+
+	printf("migration buffer usage: ");
+	print_in_proper_unit(stat.buf_mem_size);
+	printf("\n");
 	
 	// streaming write
 	rec = "toma";
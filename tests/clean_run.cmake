@@ -0,0 +1,8 @@
+# run a test program on an empty root_dir
+# cmake -DPROG=<program> -DDIR=<root_dir> -P clean_run.cmake
+file (REMOVE_RECURSE ${DIR})
+file (MAKE_DIRECTORY ${DIR})
+execute_process (COMMAND ${PROG} ${DIR}/ RESULT_VARIABLE rt)
+if (NOT rt EQUAL 0)
+	message (FATAL_ERROR "${PROG} failed: ${rt}")
+endif ()
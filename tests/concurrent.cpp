@@ -0,0 +1,171 @@
+#include "bdb.hpp"
+#include "boost/thread/thread.hpp"
+#include "boost/bind.hpp"
+#include "boost/atomic.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#define THREAD_CNT 8
+#define OP_CNT 200
+#define READER_CNT 4
+#define UPDATE_CNT 500
+
+// a record of length n is filled with 'a' + n % 26
+void fill(std::string *rec, size_t n)
+{ rec->assign(n, (char)('a' + n % 26)); }
+
+// every thread works on its own addresses, which may share pools
+void worker(BDB::BehaviorDB *bdb, int id, int *failure)
+{
+	using namespace BDB;
+
+	char data[64];
+	std::string rec;
+
+	for(int i=0; i<OP_CNT; ++i){
+		int len = sprintf(data, "t%02d-%04d", id, i);
+		AddrType addr = bdb->put(data, len);
+		if((AddrType)-1 == addr){ ++*failure; continue; }
+
+		// append to cause migration
+		if(addr != bdb->put("-appended-appended-appended", 27, addr)){
+			++*failure; continue;
+		}
+		strcat(data, "-appended-appended-appended");
+
+		rec.clear();
+		bdb->get(&rec, 1024, addr);
+		if(rec != data) ++*failure;
+
+		if(i & 1) bdb->del(addr);
+	}
+}
+
+// grows and shrinks one record so that it moves between pools
+void updater(BDB::BehaviorDB *bdb, BDB::AddrType addr, int *failure,
+	boost::atomic<bool> *done)
+{
+	std::string rec;
+	for(int i=0; i<UPDATE_CNT; ++i){
+		fill(&rec, 1 + (i * 997) % 3000);
+		if(addr != bdb->update(rec, addr)) ++*failure;
+	}
+	*done = true;
+}
+
+// reads the record without ever seeing a partial update
+void reader(BDB::BehaviorDB *bdb, BDB::AddrType addr, int *failure,
+	boost::atomic<bool> *done)
+{
+	std::string rec, should;
+	while(!*done){
+		rec.clear();
+		if(0 == bdb->get(&rec, 4096, addr)){ ++*failure; continue; }
+		fill(&should, rec.size());
+		if(rec != should) ++*failure;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace BDB;
+
+	if(argc < 2){
+		printf("./concurrent work_dir/\n");
+		return 1;
+	}
+
+	Config conf;
+	conf.root_dir = argv[1];
+	conf.concurrent = true;
+	conf.metrics_interval = 1;
+	BehaviorDB bdb(conf);
+
+	int failure[THREAD_CNT] = {};
+	boost::thread_group tg;
+	for(int i=0; i<THREAD_CNT; ++i)
+		tg.create_thread(boost::bind(&worker, &bdb, i, failure + i));
+	tg.join_all();
+
+	int total(0);
+	for(int i=0; i<THREAD_CNT; ++i)
+		total += failure[i];
+
+	printf("==== %d threads put/append/get/del ====\n", THREAD_CNT);
+	printf("should: 0 failures\n");
+	printf("result: %d failures\n", total);
+
+	// every append moves 8 bytes out of the first pool
+	Stat wstat;
+	bdb.stat(&wstat);
+	unsigned long long puts(0), gets(0);
+	for(size_t d=0; d<wstat.pools.size(); ++d){
+		puts += wstat.pools[d].latency[STAT_PUT].samples();
+		gets += wstat.pools[d].latency[STAT_GET].samples();
+	}
+	printf("==== latency histograms and migrations ====\n");
+	printf("should: %d %d %d %d\n", THREAD_CNT*OP_CNT, THREAD_CNT*OP_CNT,
+		THREAD_CNT*OP_CNT, THREAD_CNT*OP_CNT*8);
+	printf("result: %llu %llu %llu %llu\n", puts, gets, 
+		wstat.pools[0].migrations, wstat.pools[0].migrated_bytes);
+	if(THREAD_CNT*OP_CNT != puts || THREAD_CNT*OP_CNT != gets ||
+		THREAD_CNT*OP_CNT != wstat.pools[0].migrations ||
+		THREAD_CNT*OP_CNT*8 != wstat.pools[0].migrated_bytes)
+		++total;
+	wstat.dump(stdout);
+
+	// the metrics file is rewritten every second
+	std::string text, file;
+	bdb.metrics(&text);
+	boost::this_thread::sleep(boost::posix_time::milliseconds(1500));
+	std::string fname = std::string(argv[1]) + "metrics.prom";
+	if(FILE *fp = fopen(fname.c_str(), "rb")){
+		char buf[4096];
+		size_t n;
+		while(0 < (n = fread(buf, 1, sizeof(buf), fp)))
+			file.append(buf, n);
+		fclose(fp);
+	}
+	char put_cnt[128];
+	sprintf(put_cnt, "bdb_op_latency_seconds_count{dir=\"0000\",op=\"put\"} %d\n",
+		THREAD_CNT*OP_CNT);
+	printf("==== metrics in Prometheus format ====\n");
+	printf("should: 1 1\n");
+	printf("result: %d %d\n", (int)(std::string::npos != text.find(put_cnt)),
+		(int)(std::string::npos != file.find(put_cnt)));
+	if(std::string::npos == text.find(put_cnt) || 
+		std::string::npos == file.find(put_cnt))
+		++total;
+
+	std::string rec;
+	fill(&rec, 1);
+	AddrType shared = bdb.put(rec);
+	boost::atomic<bool> done(false);
+	int rfailure[READER_CNT + 1] = {};
+	
+	boost::thread_group rg;
+	for(int i=0; i<READER_CNT; ++i)
+		rg.create_thread(boost::bind(&reader, &bdb, shared, rfailure + i, &done));
+	rg.create_thread(boost::bind(&updater, &bdb, shared, rfailure + READER_CNT, &done));
+	rg.join_all();
+
+	int rtotal(0);
+	for(int i=0; i<=READER_CNT; ++i)
+		rtotal += rfailure[i];
+
+	printf("==== %d readers with 1 updater ====\n", READER_CNT);
+	printf("should: 0 failures\n");
+	printf("result: %d failures\n", rtotal);
+
+	// buffers cached by exited threads are trimmed to retention
+	BehaviorDB::buffer_retention(2*1024*1024);
+	Stat stat;
+	bdb.stat(&stat);
+	printf("==== migration buffers after shrinking retention ====\n");
+	printf("should: <= 2097152\n");
+	printf("result: %llu\n", stat.buf_mem_size);
+	if(stat.buf_mem_size > 2*1024*1024) ++rtotal;
+
+	return (total || rtotal) ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+#include "coro.hpp"
+#include "bdb.hpp"
+#include <cstdio>
+#include <string>
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+using namespace BDB;
+
+// upload in small pieces then download it back
+coro::detached
+copy_through(AsyncBehaviorDB &db, std::string data, boost::promise<std::string> *done)
+{
+	stream_state const* ss = co_await coro::ostream(db, data.size());
+	for(size_t off = 0; off < data.size(); off += 3)
+		co_await coro::write_some(db, ss, data.substr(off, 3));
+	AddrType addr = co_await coro::finish(db, ss);
+	
+	std::string rt, piece;
+	ss = co_await coro::istream(db, data.size(), addr);
+	while(!(piece = co_await coro::read_some(db, ss, 5)).empty())
+		rt += piece;
+	co_await coro::finish(db, ss);
+	co_await coro::del(db, addr);
+
+	done->set_value(rt);
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2){
+		printf("./coro work_dir/\n");
+		return 1;
+	}
+
+	Config conf;
+	conf.root_dir = argv[1];
+	conf.concurrent = true;
+	BehaviorDB bdb(conf);
+	AsyncBehaviorDB abdb(bdb, 2);
+
+	std::string data("coroutine streaming through executor");
+	boost::promise<std::string> done[2];
+	copy_through(abdb, data, done);
+	copy_through(abdb, data + " again", done + 1);
+
+	std::string r0 = done[0].get_future().get();
+	std::string r1 = done[1].get_future().get();
+	
+	printf("==== coroutine stream copy ====\n");
+	printf("should: %s\n", data.c_str());
+	printf("result: %s\n", r0.c_str());
+	printf("should: %s again\n", data.c_str());
+	printf("result: %s\n", r1.c_str());
+
+	return (r0 == data && r1 == data + " again") ? 0 : 1;
+}
+
+#else
+
+int main()
+{
+	printf("coroutine is not supported by this compiler\n");
+	return 0;
+}
+
+#endif
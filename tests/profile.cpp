@@ -0,0 +1,52 @@
+#include "bdb.hpp"
+#include "profile.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+int main(int argc, char** argv)
+{
+	using namespace BDB;
+
+	if(argc < 2){
+		printf("./profile work_dir/\n");
+		return 1;
+	}
+
+	Config conf;
+	conf.root_dir = argv[1];
+	int failure(0);
+	std::string data(10000, 'a');
+
+	printf("==== profile breakdown ====\n");
+	{
+		profile_reset();
+		{
+			BehaviorDB bdb(conf);
+			std::string got;
+			AddrType a = bdb.put(data);
+			bdb.get(&got, data.size(), a);
+			bdb.del(a);
+		}
+		FILE *fp = tmpfile();
+		bool profiled = profile_dump(fp);
+		// rows are "stage count time per_count share"
+		unsigned long long ops(0), commits(0);
+		char line[256], name[16];
+		unsigned long long cnt;
+		rewind(fp);
+		while(fgets(line, sizeof(line), fp)){
+			if(2 != sscanf(line, "%15s %llu", name, &cnt)) continue;
+			if(0 == strcmp(name, "op")) ops = cnt;
+			if(0 == strcmp(name, "commit")) commits = cnt;
+		}
+		fclose(fp);
+		// without BDB_PROFILE nothing is counted
+		bool counted = profiled ? (3 == ops && commits) : (0 == ops);
+		printf("should: 1\n");
+		printf("result: %d\n", (int)counted);
+		if(!counted) ++failure;
+	}
+
+	return failure ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+#include "sharded.hpp"
+#include "bdb.hpp"
+#include <cstdio>
+#include <string>
+#include <sys/stat.h>
+
+#define SHARD_CNT 3
+#define REC_CNT 30
+
+int main(int argc, char** argv)
+{
+	using namespace BDB;
+
+	if(argc < 2){
+		printf("./sharded work_dir/\n");
+		return 1;
+	}
+
+	std::string dirs[SHARD_CNT];
+	char const* roots[SHARD_CNT];
+	for(int i=0; i<SHARD_CNT; ++i){
+		char name[16];
+		sprintf(name, "shard%d/", i);
+		dirs[i] = std::string(argv[1]) + name;
+		mkdir(dirs[i].c_str(), 0755);
+		roots[i] = dirs[i].c_str();
+	}
+
+	Config conf;
+	conf.beg = 1;
+	conf.end = 30001;
+	ShardedBehaviorDB bdb(conf, roots, SHARD_CNT);
+	
+	int failure(0);
+
+	printf("==== routing ====\n");
+	printf("should: 0 1 2 -1\n");
+	printf("result: %d %d %d %d\n", 
+		(int)bdb.shard_of(1), (int)bdb.shard_of(10001),
+		(int)bdb.shard_of(30000), (int)bdb.shard_of(30001));
+	if(2 != bdb.shard_of(30000) || -1 != (int)bdb.shard_of(30001))
+		++failure;
+
+	printf("==== put_batch spreads over shards ====\n");
+	std::string data[REC_CNT];
+	AddrType addrs[REC_CNT];
+	int per_shard[SHARD_CNT] = {};
+	for(int i=0; i<REC_CNT; ++i){
+		char buf[32];
+		sprintf(buf, "record-%03d", i);
+		data[i] = buf;
+	}
+	size_t cnt = bdb.put_batch(data, addrs, REC_CNT);
+	for(int i=0; i<REC_CNT; ++i)
+		if(-1 != (int)addrs[i]) per_shard[bdb.shard_of(addrs[i])]++;
+	printf("should: %d (%d %d %d)\n", REC_CNT, 
+		REC_CNT/SHARD_CNT, REC_CNT/SHARD_CNT, REC_CNT/SHARD_CNT);
+	printf("result: %d (%d %d %d)\n", (int)cnt, 
+		per_shard[0], per_shard[1], per_shard[2]);
+	if(REC_CNT != cnt) ++failure;
+
+	printf("==== append and get_batch ====\n");
+	bdb.put("-tail", 5, addrs[4]);
+	data[4] += "-tail";
+	std::string out[REC_CNT];
+	cnt = bdb.get_batch(out, 1024, addrs, REC_CNT);
+	int mismatch(0);
+	for(int i=0; i<REC_CNT; ++i)
+		if(out[i] != data[i]) ++mismatch;
+	printf("should: %d %s\n", REC_CNT, data[4].c_str());
+	printf("result: %d %s\n", (int)cnt, out[4].c_str());
+	if(REC_CNT != cnt || mismatch) ++failure;
+
+	printf("==== stream on a shard ====\n");
+	stream_state const* ss = bdb.istream(6, addrs[7]);
+	char rd[7] = {};
+	bdb.stream_read(ss, rd, 6);
+	bdb.stream_finish(ss);
+	ss = bdb.ostream(4);
+	size_t handle = bdb.stream_pause(ss);
+	ss = bdb.stream_resume(handle);
+	bdb.stream_write(ss, "toma", 4);
+	AddrType saddr = bdb.stream_finish(ss);
+	std::string srec;
+	bdb.get(&srec, 10, saddr);
+	printf("should: record toma\n");
+	printf("result: %s %s\n", rd, srec.c_str());
+	if(srec != "toma") ++failure;
+
+	printf("==== vectored and batched appends ====\n");
+	{
+		Segment segs[2] = { { "ab", 2 }, { "cd", 2 } };
+		AddrType va = bdb.putv(segs, 2);
+		bdb.appendv(segs, 1, va);
+		// one append per shard, the last one out of range
+		AddrType targets[SHARD_CNT + 1];
+		WriteVector wvs[SHARD_CNT + 1];
+		for(int i=0; i<SHARD_CNT + 1; ++i){
+			targets[i] = (i < SHARD_CNT) ? addrs[i] : 30001;
+			wvs[i].buffer = "+";
+			wvs[i].size = 1;
+			wvs[i].address = &targets[i];
+		}
+		size_t appended = bdb.append(wvs, SHARD_CNT + 1);
+		char part[3] = {};
+		MutableSegment ms[1] = { { part, 2 } };
+		size_t got = bdb.getv(ms, 1, va, 4);
+		std::string rec;
+		bdb.get(&rec, 1024, targets[2]);
+		bool ok = SHARD_CNT == appended && 2 == got && 
+			std::string(part) == "ab" && rec == data[2] + "+" &&
+			(AddrType)-1 == targets[SHARD_CNT];
+		printf("should: %d ab %s+ 1\n", SHARD_CNT, data[2].c_str());
+		printf("result: %d %s %s %d\n", (int)appended, part, rec.c_str(),
+			(int)((AddrType)-1 == targets[SHARD_CNT]));
+		if(!ok) ++failure;
+		for(int i=0; i<SHARD_CNT; ++i){
+			addrs[i] = targets[i];
+			data[i] += "+";
+		}
+		bdb.del(va);
+	}
+
+	printf("==== repeated batch calls ====\n");
+	{
+		// shard workers are kept across calls
+		int rounds(0);
+		for(int r=0; r<50; ++r){
+			std::string got[REC_CNT];
+			if(REC_CNT == bdb.get_batch(got, 1024, addrs, REC_CNT) &&
+				got[REC_CNT-1] == data[REC_CNT-1])
+				++rounds;
+		}
+		printf("should: 50\n");
+		printf("result: %d\n", rounds);
+		if(50 != rounds) ++failure;
+	}
+
+	printf("==== del_batch and stat ====\n");
+	cnt = bdb.del_batch(addrs, REC_CNT);
+	Stat all, one;
+	bdb.stat(&all);
+	bdb.shard(0).stat(&one);
+	printf("should: %d > 0\n", REC_CNT);
+	printf("result: %d %llu\n", (int)cnt, all.disk_size);
+	if(REC_CNT != cnt || 0 == all.disk_size || 
+		all.gid_mem_size <= one.gid_mem_size)
+		++failure;
+
+	printf("==== del_range across shards ====\n");
+	{
+		AddrType a[REC_CNT];
+		bdb.put_batch(data, a, REC_CNT);
+		cnt = bdb.del_range(0, (AddrType)-1);
+		std::string rec;
+		int left(0);
+		for(int i=0; i<REC_CNT; ++i)
+			if(bdb.get(&rec, 1024, a[i])) ++left;
+		printf("should: %d 0\n", REC_CNT + 1);
+		printf("result: %d %d\n", (int)cnt, left);
+		if(REC_CNT + 1 != cnt || left) ++failure;
+	}
+
+	return failure ? 1 : 0;
+}
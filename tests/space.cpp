@@ -0,0 +1,53 @@
+#include "bdb.hpp"
+#include <cstdio>
+#include <string>
+
+int main(int argc, char** argv)
+{
+	using namespace BDB;
+
+	if(argc < 2){
+		printf("./space work_dir/\n");
+		return 1;
+	}
+
+	Config conf;
+	conf.root_dir = argv[1];
+	int failure(0);
+	std::string data(10000, 'a');
+
+	printf("==== space statistics survive restart ====\n");
+	{
+		unsigned long long before[3] = {}, after[3] = {};
+		{
+			BehaviorDB bdb(conf);
+			AddrType a(0);
+			for(int i=0; i<4; ++i)
+				a = bdb.put(data);
+			bdb.del(a, 0, 1000);
+			Stat st;
+			bdb.stat(&st);
+			for(size_t d=0; d<st.pools.size(); ++d){
+				before[0] += st.pools[d].chunks;
+				before[1] += st.pools[d].data_bytes;
+				before[2] += st.pools[d].bytes_requested;
+			}
+		}
+		BehaviorDB bdb(conf);
+		Stat st;
+		bdb.stat(&st);
+		for(size_t d=0; d<st.pools.size(); ++d){
+			after[0] += st.pools[d].chunks;
+			after[1] += st.pools[d].data_bytes;
+			after[2] += st.pools[d].bytes_requested;
+		}
+		printf("should: 4 39000 40000 4 39000 0\n");
+		printf("result: %llu %llu %llu %llu %llu %llu\n", before[0],
+			before[1], before[2], after[0], after[1], after[2]);
+		if(4 != before[0] || 39000 != before[1] || 40000 != before[2] ||
+			4 != after[0] || 39000 != after[1] || 0 != after[2])
+			++failure;
+	}
+
+	return failure ? 1 : 0;
+}
@@ -0,0 +1,290 @@
+#include "bdb.hpp"
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define STREAM_SIZ (600*1024)
+
+namespace {
+
+	std::string
+	pattern(size_t size, int seed)
+	{
+		std::string rt(size, 0);
+		for(size_t i=0; i<size; ++i)
+			rt[i] = (char)('a' + (i * 7 + seed) % 26);
+		return rt;
+	}
+
+	// write data to a stream in frames of frame bytes
+	BDB::stream_state const*
+	write_frames(BDB::BehaviorDB &bdb, BDB::stream_state const* os,
+		std::string const& data, size_t frame)
+	{
+		for(size_t i=0; os && i<data.size(); i+=frame){
+			size_t n = (data.size() - i < frame) ? data.size() - i : frame;
+			os = bdb.stream_write(os, data.data() + i, n);
+		}
+		return os;
+	}
+
+} // end of anonymous namespace
+
+int main(int argc, char** argv)
+{
+	using namespace BDB;
+
+	if(argc < 2){
+		printf("./stream work_dir/\n");
+		return 1;
+	}
+
+	Config conf;
+	conf.root_dir = argv[1];
+	BehaviorDB bdb(conf);
+	int failure(0);
+	std::string rec;
+
+	printf("==== buffered stream write ====\n");
+	std::string data = pattern(STREAM_SIZ, 0);
+	stream_state const* os = bdb.ostream(data.size());
+	os = write_frames(bdb, os, data.substr(0, 300*1024), 3000);
+	// a frame larger than the buffer bypasses it
+	os = write_frames(bdb, os, data.substr(300*1024), 300*1024);
+	AddrType addr = bdb.stream_finish(os);
+	bdb.get(&rec, STREAM_SIZ, addr);
+	printf("should: 1\n");
+	printf("result: %d\n", (int)(rec == data));
+	if(rec != data) ++failure;
+
+	printf("==== unbuffered stream write ====\n");
+	os = bdb.ostream(data.size());
+	os = bdb.stream_buffer(os, 0);
+	os = write_frames(bdb, os, data, 4096);
+	AddrType addr2 = bdb.stream_finish(os);
+	bdb.get(&rec, STREAM_SIZ, addr2);
+	printf("should: 1\n");
+	printf("result: %d\n", (int)(rec == data));
+	if(rec != data) ++failure;
+
+	printf("==== pause and resume with pending data ====\n");
+	std::string tail = pattern(10000, 3);
+	os = bdb.ostream(tail.size(), addr2);
+	os = write_frames(bdb, os, tail.substr(0, 5000), 1000);
+	size_t handle = bdb.stream_pause(os);
+	os = bdb.stream_resume(handle);
+	os = write_frames(bdb, os, tail.substr(5000), 700);
+	bdb.stream_finish(os);
+	bdb.get(&rec, STREAM_SIZ + tail.size(), addr2);
+	printf("should: 1\n");
+	printf("result: %d\n", (int)(rec == data + tail));
+	if(rec != data + tail) ++failure;
+
+	printf("==== abort drops pending data ====\n");
+	os = bdb.ostream(100, addr);
+	os = write_frames(bdb, os, tail.substr(0, 50), 10);
+	bdb.stream_abort(os);
+	bdb.get(&rec, STREAM_SIZ + 100, addr);
+	printf("should: 1\n");
+	printf("result: %d\n", (int)(rec == data));
+	if(rec != data) ++failure;
+
+	printf("==== sequential stream read ====\n");
+	{
+		// small frames over the read-ahead windows, then an offset
+		std::string got;
+		char frame[4096];
+		stream_state const* is = bdb.istream(data.size(), addr);
+		for(size_t i=0; is && i<data.size(); i+=sizeof(frame)){
+			size_t n = (data.size() - i < sizeof(frame)) ?
+				data.size() - i : sizeof(frame);
+			is = bdb.stream_read(is, frame, n);
+			if(is) got.append(frame, n);
+		}
+		bdb.stream_finish(is);
+
+		is = bdb.istream(100, addr, 500000);
+		is = bdb.stream_read(is, frame, 100);
+		bool off_ok = std::string(frame, 100) == data.substr(500000, 100);
+		bdb.stream_finish(is);
+		printf("should: 1 1\n");
+		printf("result: %d %d\n", (int)(got == data), (int)off_ok);
+		if(got != data || !off_ok) ++failure;
+	}
+
+	printf("==== stream read sees in-place append ====\n");
+	{
+		AddrType small = bdb.put("abcd", 4);
+		char frame[9] = {};
+		stream_state const* is = bdb.istream(8, small);
+		is = bdb.stream_read(is, frame, 4);
+		bdb.put("efgh", 4, small);
+		if(is) is = bdb.stream_read(is, frame + 4, 4);
+		bdb.stream_finish(is);
+		printf("should: abcdefgh\n");
+		printf("result: %s\n", frame);
+		if(std::string(frame) != "abcdefgh") ++failure;
+		bdb.del(small);
+	}
+
+	printf("==== view outlives delete ====\n");
+	{
+		View v = bdb.view(addr);
+		View part = bdb.view(addr, 1000, 50);
+		bdb.del(addr);
+		// would reuse the freed chunk if it were not pinned
+		std::string other = pattern(STREAM_SIZ, 5);
+		AddrType tmp = bdb.put(other);
+		bool v_ok = v.data && v.size == data.size() &&
+			std::string(v.data, v.size) == data;
+		bool part_ok = part.data && 
+			std::string(part.data, part.size) == data.substr(1000, 50);
+		bdb.release(v);
+		bdb.release(part);
+		bdb.get(&rec, STREAM_SIZ, tmp);
+		View gone = bdb.view(addr);
+		printf("should: 1 1 1 0\n");
+		printf("result: %d %d %d %d\n", (int)v_ok, (int)part_ok, 
+			(int)(rec == other), (int)(0 != gone.data));
+		if(!v_ok || !part_ok || rec != other || gone.data) ++failure;
+		bdb.del(tmp);
+	}
+
+	printf("==== stream of unknown size ====\n");
+	{
+		os = bdb.ostream(npos);
+		os = write_frames(bdb, os, data.substr(0, 300*1024), 3000);
+		os = write_frames(bdb, os, data.substr(300*1024), 300*1024);
+		AddrType grown = bdb.stream_finish(os);
+		std::string got;
+		size_t got_size = bdb.get(&got, 2*STREAM_SIZ, grown);
+
+		// unbuffered, growing on every few writes
+		os = bdb.ostream(npos);
+		os = bdb.stream_buffer(os, 0);
+		os = write_frames(bdb, os, tail, 100);
+		AddrType small = bdb.stream_finish(os);
+		bdb.get(&rec, 2*STREAM_SIZ, small);
+		
+		printf("should: 1 1 1\n");
+		printf("result: %d %d %d\n", (int)(got == data), 
+			(int)(got_size == data.size()), (int)(rec == tail));
+		if(got != data || got_size != data.size() || rec != tail) 
+			++failure;
+		bdb.del(grown);
+		bdb.del(small);
+	}
+
+	printf("==== stream filling chunks exactly ====\n");
+	{
+		// power-of-two totals end right at a chunk boundary
+		size_t const totals[] = { 4096, 8192, 16384, 65536, 1024*1024 };
+		int matched(0);
+		for(size_t i=0; i<sizeof(totals)/sizeof(totals[0]); ++i){
+			std::string exact = pattern(totals[i], (int)i);
+			os = bdb.ostream(npos);
+			os = write_frames(bdb, os, exact, 4096);
+			AddrType a = bdb.stream_finish(os);
+			bdb.get(&rec, 2*totals[i], a);
+			if(rec == exact) ++matched;
+			bdb.del(a);
+		}
+		printf("should: 5\n");
+		printf("result: %d\n", matched);
+		if(5 != matched) ++failure;
+	}
+
+	printf("==== send to file descriptor ====\n");
+	{
+		AddrType src = bdb.put(data);
+		FILE *fp = tmpfile();
+		size_t whole = bdb.send_to_fd(src, fileno(fp));
+		size_t part = bdb.send_to_fd(src, fileno(fp), 1000, 5000);
+		std::string sent(whole + part, 0);
+		size_t got = pread(fileno(fp), &sent[0], sent.size(), 0);
+		fclose(fp);
+		bool ok = whole == data.size() && part == 5000 && 
+			got == sent.size() && sent == data + data.substr(1000, 5000);
+		printf("should: 1\n");
+		printf("result: %d\n", (int)ok);
+		if(!ok) ++failure;
+		bdb.del(src);
+	}
+
+	printf("==== put from file descriptor ====\n");
+	{
+		FILE *fp = tmpfile();
+		fwrite(data.data(), 1, data.size(), fp);
+		fflush(fp);
+		lseek(fileno(fp), 0, SEEK_SET);
+		AddrType from_file = bdb.put_from_fd(fileno(fp), data.size());
+		// the file ends before the size asked
+		lseek(fileno(fp), 0, SEEK_SET);
+		AddrType short_read = bdb.put_from_fd(fileno(fp), data.size() + 1);
+		fclose(fp);
+		bdb.get(&rec, 2*STREAM_SIZ, from_file);
+		bool file_ok = (rec == data);
+
+		int pp[2];
+		bool pipe_ok = false;
+		if(0 == pipe(pp)){
+			write(pp[1], tail.data(), tail.size());
+			close(pp[1]);
+			os = bdb.ostream(npos);
+			os = bdb.stream_write(os, "head", 4);
+			os = bdb.stream_write_from_fd(os, pp[0], tail.size());
+			AddrType from_pipe = bdb.stream_finish(os);
+			close(pp[0]);
+			bdb.get(&rec, 2*STREAM_SIZ, from_pipe);
+			pipe_ok = (rec == "head" + tail);
+			bdb.del(from_pipe);
+		}
+		printf("should: 1 1 1\n");
+		printf("result: %d %d %d\n", (int)file_ok, (int)pipe_ok, 
+			(int)((AddrType)-1 == short_read));
+		if(!file_ok || !pipe_ok || (AddrType)-1 != short_read) ++failure;
+		bdb.del(from_file);
+	}
+
+	printf("==== paused streams survive restart ====\n");
+	{
+		// another BehaviorDB in a sub-directory of work_dir
+		std::string rdir = std::string(argv[1]) + "restart/";
+		mkdir(rdir.c_str(), 0755);
+		Config rconf;
+		rconf.root_dir = rdir.c_str();
+		size_t h_new, h_ins;
+		AddrType base;
+		{
+			BehaviorDB db(rconf);
+			base = db.put(tail);
+			os = db.ostream(data.size());
+			os = write_frames(db, os, data.substr(0, 200000), 4096);
+			h_new = db.stream_pause(os);
+			os = db.ostream(tail.size(), base);
+			os = write_frames(db, os, tail.substr(0, 5000), 1000);
+			h_ins = db.stream_pause(os);
+			// left open; its chunk is reclaimed at restart
+			os = db.ostream(npos);
+			os = db.stream_buffer(os, 0);
+			os = db.stream_write(os, "lost", 4);
+		}
+		BehaviorDB db(rconf);
+		os = db.stream_resume(h_new);
+		os = write_frames(db, os, data.substr(200000), 4096);
+		AddrType resumed = db.stream_finish(os);
+		bool new_ok = ((AddrType)-1 != resumed && 
+			db.get(&rec, 2*STREAM_SIZ, resumed) && rec == data);
+		os = db.stream_resume(h_ins);
+		os = write_frames(db, os, tail.substr(5000), 1000);
+		bool ins_ok = (base == db.stream_finish(os) &&
+			db.get(&rec, 2*STREAM_SIZ, base) && rec == tail + tail);
+		bool gone = (0 == db.stream_resume(h_new));
+		printf("should: 1 1 1\n");
+		printf("result: %d %d %d\n", (int)new_ok, (int)ins_ok, (int)gone);
+		if(!new_ok || !ins_ok || !gone) ++failure;
+	}
+
+	return failure ? 1 : 0;
+}
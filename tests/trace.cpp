@@ -0,0 +1,99 @@
+#include "bdb.hpp"
+#include "trace.hpp"
+#include "access_rec.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+
+	// count events per stage and check that they nest
+	struct counting_sink : BDB::ChromeTraceSink
+	{
+		counting_sink(char const* fname)
+		: BDB::ChromeTraceSink(fname), depth(0), nested(true)
+		{ memset(begins, 0, sizeof(begins)); }
+
+		void
+		event(BDB::TraceEvent const &ev)
+		{
+			if(ev.begin){
+				++begins[ev.stage];
+				++depth;
+			}else if(0 == depth--)
+				nested = false;
+			BDB::ChromeTraceSink::event(ev);
+		}
+
+		size_t begins[BDB::TRACE_STAGE_CNT];
+		int depth;
+		bool nested;
+	};
+
+} // end of anonymous namespace
+
+int main(int argc, char** argv)
+{
+	using namespace BDB;
+
+	if(argc < 2){
+		printf("./trace work_dir/\n");
+		return 1;
+	}
+
+	Config conf;
+	conf.root_dir = argv[1];
+	int failure(0);
+	std::string data(10000, 'a');
+
+	printf("==== trace events ====\n");
+	{
+		std::string tname = std::string(argv[1]) + "trace.json";
+		bool traced(false), staged(false), nested(false);
+		{
+			counting_sink sink(tname.c_str());
+			{
+				BehaviorDB bdb(conf);
+				traced = set_trace_sink(&sink);
+				std::string got;
+				AddrType a = bdb.put(data);
+				bdb.get(&got, data.size(), a);
+				bdb.del(a);
+				set_trace_sink(0);
+			}
+			// without trace points the sink is fed by hand
+			if(!traced){
+				TraceEvent ev = { TRACE_OP, true, ACC_PUT, 1, -1, 0, 0, 0 };
+				sink.event(ev);
+				ev.stage = TRACE_FILE_WRITE;
+				sink.event(ev);
+				ev.begin = false;
+				sink.event(ev);
+				ev.stage = TRACE_OP;
+				sink.event(ev);
+			}
+			staged = traced ?
+				(3 == sink.begins[TRACE_OP] && sink.begins[TRACE_COMMIT] &&
+				 sink.begins[TRACE_FILE_WRITE] && sink.begins[TRACE_FILE_READ]) :
+				(1 == sink.begins[TRACE_OP]);
+			nested = sink.nested && 0 == sink.depth;
+		}
+		std::string json;
+		FILE *fp = fopen(tname.c_str(), "rb");
+		if(fp){
+			char buf[4096];
+			size_t n;
+			while(0 < (n = fread(buf, 1, sizeof(buf), fp)))
+				json.append(buf, n);
+			fclose(fp);
+		}
+		bool framed = 0 == json.find("{\"traceEvents\":[") &&
+			json.size() > 3 && "]}\n" == json.substr(json.size() - 3) &&
+			std::string::npos != json.find("\"name\":\"put\"");
+		printf("should: 1 1 1\n");
+		printf("result: %d %d %d\n", (int)staged, (int)nested, (int)framed);
+		if(!staged || !nested || !framed) ++failure;
+	}
+
+	return failure ? 1 : 0;
+}
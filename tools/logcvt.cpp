@@ -4,6 +4,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include "access_rec.hpp"
 
 using namespace std;
 
@@ -11,13 +12,55 @@ void usage()
 {
 	cerr<<"Convert put log to get log"<<endl;
 	cerr<<"logcvt put_log output"<<endl;
+	cerr<<"Convert binary access log to text, -t appends time and latency"<<endl;
+	cerr<<"logcvt -b[t] access_log output"<<endl;
 	exit(0);
 }
 
+int bin2text(char const* in, char const* out, bool timing)
+{
+	using namespace BDB;
+
+	FILE *fin = fopen(in, "rb");
+	FILE *fout = fopen(out, "wb");
+	if(!fin || !fout) usage();
+
+	char magic[ACCESS_LOG_MAGIC_LEN];
+	if(1 != fread(magic, ACCESS_LOG_MAGIC_LEN, 1, fin) ||
+		0 != memcmp(magic, ACCESS_LOG_MAGIC, ACCESS_LOG_MAGIC_LEN))
+	{
+		cerr<<in<<" is not a binary access log"<<endl;
+		return 1;
+	}
+
+	access_record rec;
+	while(1 == fread(&rec, sizeof(rec), 1, fin)){
+		unsigned int arity = access_op_arity(rec.op);
+		fprintf(fout, "%-12s", access_op_name(rec.op));
+		for(unsigned int i=0; i<arity; ++i)
+			fprintf(fout, "\t%08x", rec.arg[i]);
+		if(timing)
+			fprintf(fout, "\t%llu.%09llu\t%u", 
+				(unsigned long long)(rec.time / 1000000000u),
+				(unsigned long long)(rec.time % 1000000000u),
+				rec.latency);
+		fprintf(fout, "\n");
+	}
+
+	fclose(fout);
+	fclose(fin);
+	return 0;
+}
+
 int main(int argc, char** argv)
 {
 	if(argc < 3 ) usage();
 	
+	if(0 == strncmp(argv[1], "-b", 2)){
+		if(argc < 4) usage();
+		return bin2text(argv[2], argv[3], 0 != strchr(argv[1], 't'));
+	}
+
 	char ibuf[102400];
 	char obuf[102400];
 	ifstream fin;	
@@ -37,7 +80,7 @@ int main(int argc, char** argv)
 	char fmt_log[100]={};
 	int len(0);
 	while(fin>>token){
-		if("put" != token || 0 == fin>>token ) break;
+		if("put" != token || !(fin>>token) ) break;
 		size = strtoul(token.c_str(), 0, 16);
 		len = snprintf(fmt_log, 100, "%-12s\t%08x\t%08x\t%08x\n", 
 			"get", size, address, 0); 